@@ -14,6 +14,7 @@
 #include <DataStorm/InternalT.h>
 #include <DataStorm/CtrlCHandler.h>
 
+#include <limits>
 #include <regex>
 
 /**
@@ -282,6 +283,33 @@ public:
      */
     std::vector<Sample<Key, Value, UpdateTag>> getAllUnread() noexcept;
 
+    /**
+     * Returns at most the given number of unread samples. The returned samples
+     * are the oldest unread samples, they are removed from the unread samples.
+     *
+     * @param count The maximum number of samples to return.
+     * @return The unread samples.
+     */
+    std::vector<Sample<Key, Value, UpdateTag>> take(size_t count) noexcept;
+
+    /**
+     * Moves all the unread samples to the end of the given container. The
+     * container must provide emplace_back. Reusing the same container to drain
+     * the unread samples avoids allocating a new container for each call.
+     *
+     * @param samples The container to add the unread samples to.
+     */
+    template<typename Container> void drainInto(Container& samples) noexcept;
+
+    /**
+     * Calls the given function for each unread sample. The unread samples are
+     * removed from the reader before the function is called.
+     *
+     * @param visitor The function to call with each unread sample.
+     * @return The number of unread samples.
+     */
+    size_t forEachUnread(std::function<void(const Sample<Key, Value, UpdateTag>&)> visitor);
+
     /**
      * Wait for given number of unread samples to be available. The node
      * shutdown will cause this method to raise NodeShutdownException.
@@ -303,6 +331,24 @@ public:
      */
     Sample<Key, Value, UpdateTag> getNextUnread();
 
+    /**
+     * Get the last sample received for the given key. The reader must be
+     * configured with the last value cache. If there's no sample for the key,
+     * the std::logic_error exception is raised.
+     *
+     * @param key The key.
+     * @return The last sample received for the key.
+     **/
+    Sample<Key, Value, UpdateTag> getLast(const Key& key) const;
+
+    /**
+     * Get the last sample received for each key. The reader must be configured
+     * with the last value cache.
+     *
+     * @return The last samples.
+     **/
+    std::vector<Sample<Key, Value, UpdateTag>> getAllLast() const noexcept;
+
     /**
      * Calls the given functions to provide the initial set of connected keys and
      * when a key is added or removed from the set of connected keys. If callback
@@ -352,15 +398,38 @@ public:
     void onSamples(std::function<void(std::vector<Sample<Key, Value, UpdateTag>>)> init,
                    std::function<void(Sample<Key, Value, UpdateTag>)> queue) noexcept;
 
+    /**
+     * Calls the given function with batches of samples. The samples received
+     * by the reader between two calls are provided with a single call rather
+     * than with a call for each sample.
+     *
+     * If a function is already set, it will be replaced.
+     *
+     * The function is called after this method returns with the initial set
+     * of unread samples if any. It's then called when new samples are received.
+     *
+     * @param batch The function to call with the samples.
+     **/
+    void onSampleBatch(std::function<void(const std::vector<Sample<Key, Value, UpdateTag>>&)> batch) noexcept;
+
 protected:
 
     /** @private */
-    Reader(const std::shared_ptr<DataStormI::DataReader>& impl) noexcept : _impl(impl)
+    Reader(const std::shared_ptr<DataStormI::DataReader>& impl,
+           const std::shared_ptr<DataStormI::KeyFactoryT<Key>>& keyFactory) noexcept :
+        _impl(impl),
+        _keyFactory(keyFactory)
     {
     }
 
+    /** @private */
+    template<typename Container> void drainInto(Container&, size_t) noexcept;
+
     /** @private */
     std::shared_ptr<DataStormI::DataReader> _impl;
+
+    /** @private */
+    std::shared_ptr<DataStormI::KeyFactoryT<Key>> _keyFactory;
 };
 
 /**
@@ -453,6 +522,13 @@ public:
      **/
     std::vector<Sample<Key, Value, UpdateTag>> getAll() noexcept;
 
+    /**
+     * Send the samples accumulated by the writer to the readers. Samples are
+     * only accumulated if the writer is configured with a flush interval or
+     * flush size, otherwise this method does nothing.
+     */
+    void flush() noexcept;
+
     /**
      * Calls the given functions to provide the initial set of connected keys and
      * when a key is added or removed from the set of connected keys. If callback
@@ -486,6 +562,18 @@ public:
     void onConnectedReaders(std::function<void(std::vector<std::string>)> init,
                             std::function<void(CallbackReason, std::string)> update) noexcept;
 
+    /**
+     * Calls the given function when a reader reaches the writer high-water mark
+     * and when the requests queued for the reader drop back below the high-water
+     * mark. If a callback function is already set, it will be replaced.
+     *
+     * The callback is called with the identifier of the session of the reader
+     * and true if the reader reached the high-water mark, false otherwise.
+     *
+     * @param callback The function to call when a reader crosses the high-water mark.
+     **/
+    void onOverflow(std::function<void(std::string, bool)> callback) noexcept;
+
 protected:
 
     /** @private */
@@ -675,6 +763,7 @@ private:
     const std::shared_ptr<DataStormI::TopicFactory> _topicFactory;
     const std::shared_ptr<DataStormI::KeyFactoryT<Key>> _keyFactory;
     const std::shared_ptr<DataStormI::TagFactoryT<UpdateTag>> _tagFactory;
+    const std::shared_ptr<DataStormI::SampleFactoryT<Key, Value, UpdateTag>> _sampleFactory;
 
     const std::shared_ptr<DataStormI::FilterManagerT<DataStormI::KeyT<Key>>> _keyFilterFactories;
     const std::shared_ptr<DataStormI::FilterManagerT<DataStormI::SampleT<Key, Value, UpdateTag>>> _sampleFilterFactories;
@@ -1124,6 +1213,41 @@ public:
 private:
 
     const std::shared_ptr<DataStormI::TagFactoryT<UpdateTag>> _tagFactory;
+    const std::shared_ptr<DataStormI::SampleFactoryT<Key, Value, UpdateTag>> _sampleFactory;
+};
+
+/**
+ * A key handle references a key of a topic. It's obtained with {@link MultiKeyWriter::getKeyHandle}
+ * and can be used to publish samples for this key without looking up the key each time a
+ * sample is published. A key handle should only be used with writers of the topic it was
+ * obtained from.
+ *
+ * @headerfile DataStorm/DataStorm.h
+ */
+template<typename Key> class KeyHandle
+{
+public:
+
+    /**
+     * Construct an empty key handle. It must be assigned a handle obtained from a writer
+     * before being used.
+     */
+    KeyHandle() noexcept = default;
+
+    /**
+     * Get the key referenced by this handle.
+     *
+     * @return The key.
+     */
+    const Key& getKey() const noexcept;
+
+private:
+
+    explicit KeyHandle(std::shared_ptr<DataStormI::Key>) noexcept;
+
+    template<typename, typename, typename> friend class MultiKeyWriter;
+
+    std::shared_ptr<DataStormI::Key> _impl;
 };
 
 /**
@@ -1183,6 +1307,15 @@ public:
      */
     void update(const Key& key, const Value& value) noexcept;
 
+    /**
+     * Update the data elements. This generates an {@link Update} sample for each of the
+     * given key and value pairs. The samples are published together and sent to each reader
+     * with a single request.
+     *
+     * @param values The keys and values of the data elements to update.
+     */
+    void update(const std::vector<std::pair<Key, Value>>& values) noexcept;
+
     /**
      * Get a partial udpate generator function for the given partial update tag. When called,
      * the returned function generates a {@link PartialUpdate} sample with the given partial
@@ -1203,10 +1336,60 @@ public:
      */
     void remove(const Key& key) noexcept;
 
+    /**
+     * Get a handle for the given key. The handle can be passed to the add, update,
+     * partialUpdate and remove methods instead of the key to avoid the key lookup
+     * when the sample is published.
+     *
+     * @param key The key.
+     * @return The key handle.
+     */
+    KeyHandle<Key> getKeyHandle(const Key& key) const noexcept;
+
+    /**
+     * Add the data element. This generates an {@link Add} sample with the
+     * given value.
+     *
+     * @param key The key handle
+     * @param value The data element value.
+     */
+    void add(const KeyHandle<Key>& key, const Value& value) noexcept;
+
+    /**
+     * Update the data element. This generates an {@link Update} sample with the
+     * given value.
+     *
+     * @param key The key handle
+     * @param value The data element value.
+     */
+    void update(const KeyHandle<Key>& key, const Value& value) noexcept;
+
+    /**
+     * Get a partial udpate generator function for the given partial update tag and key
+     * handle. When called, the returned function generates a {@link PartialUpdate} sample
+     * for the key with the given partial update value.
+     *
+     * The UpdateValue template parameter must match the UpdateValue type used to register
+     * the updater with the {@link Topic::setUpdater} method.
+     *
+     * @param tag The partial update tag.
+     * @param key The key handle.
+     */
+    template<typename UpdateValue> std::function<void(const UpdateValue&)>
+    partialUpdate(const UpdateTag& tag, const KeyHandle<Key>& key) noexcept;
+
+    /**
+     * Remove the data element. This generates a {@link Remove} sample.
+
+     * @param key The key handle
+     */
+    void remove(const KeyHandle<Key>& key) noexcept;
+
 private:
 
     const std::shared_ptr<DataStormI::KeyFactoryT<Key>> _keyFactory;
     const std::shared_ptr<DataStormI::TagFactoryT<UpdateTag>> _tagFactory;
+    const std::shared_ptr<DataStormI::SampleFactoryT<Key, Value, UpdateTag>> _sampleFactory;
 };
 
 /**
@@ -1325,7 +1508,9 @@ template<typename Key, typename Value, typename UpdateTag> Sample<Key, Value, Up
 // Reader template implementation
 //
 template<typename Key, typename Value, typename UpdateTag>
-Reader<Key, Value, UpdateTag>::Reader(Reader<Key, Value, UpdateTag>&& reader) noexcept : _impl(std::move(reader._impl))
+Reader<Key, Value, UpdateTag>::Reader(Reader<Key, Value, UpdateTag>&& reader) noexcept :
+    _impl(std::move(reader._impl)),
+    _keyFactory(std::move(reader._keyFactory))
 {
 }
 
@@ -1346,6 +1531,7 @@ Reader<Key, Value, UpdateTag>::operator=(Reader&& reader) noexcept
         _impl->destroy();
     }
     _impl = std::move(reader._impl);
+    _keyFactory = std::move(reader._keyFactory);
     return *this;
 }
 
@@ -1392,13 +1578,50 @@ Reader<Key, Value, UpdateTag>::getAllUnread() noexcept
     auto unread = _impl->getAllUnread();
     std::vector<Sample<Key, Value, UpdateTag>> samples;
     samples.reserve(unread.size());
-    for(auto sample : unread)
+    for(const auto& sample : unread)
     {
         samples.emplace_back(sample);
     }
     return samples;
 }
 
+template<typename Key, typename Value, typename UpdateTag> std::vector<Sample<Key, Value, UpdateTag>>
+Reader<Key, Value, UpdateTag>::take(size_t count) noexcept
+{
+    std::vector<Sample<Key, Value, UpdateTag>> samples;
+    drainInto(samples, count);
+    return samples;
+}
+
+template<typename Key, typename Value, typename UpdateTag> template<typename Container> void
+Reader<Key, Value, UpdateTag>::drainInto(Container& samples) noexcept
+{
+    drainInto(samples, std::numeric_limits<size_t>::max());
+}
+
+template<typename Key, typename Value, typename UpdateTag> size_t
+Reader<Key, Value, UpdateTag>::forEachUnread(std::function<void(const Sample<Key, Value, UpdateTag>&)> visitor)
+{
+    std::vector<std::shared_ptr<DataStormI::Sample>> unread;
+    _impl->takeUnread(std::numeric_limits<size_t>::max(), unread);
+    for(const auto& sample : unread)
+    {
+        visitor(Sample<Key, Value, UpdateTag>(sample));
+    }
+    return unread.size();
+}
+
+template<typename Key, typename Value, typename UpdateTag> template<typename Container> void
+Reader<Key, Value, UpdateTag>::drainInto(Container& samples, size_t count) noexcept
+{
+    std::vector<std::shared_ptr<DataStormI::Sample>> unread;
+    _impl->takeUnread(count, unread);
+    for(const auto& sample : unread)
+    {
+        samples.emplace_back(sample);
+    }
+}
+
 template<typename Key, typename Value, typename UpdateTag> void
 Reader<Key, Value, UpdateTag>::waitForUnread(unsigned int count) const
 {
@@ -1417,6 +1640,30 @@ Reader<Key, Value, UpdateTag>::getNextUnread()
     return Sample<Key, Value, UpdateTag>(_impl->getNextUnread());
 }
 
+template<typename Key, typename Value, typename UpdateTag> Sample<Key, Value, UpdateTag>
+Reader<Key, Value, UpdateTag>::getLast(const Key& key) const
+{
+    auto sample = _impl->getLast(_keyFactory->create(key));
+    if(!sample)
+    {
+        throw std::logic_error("no sample");
+    }
+    return Sample<Key, Value, UpdateTag>(sample);
+}
+
+template<typename Key, typename Value, typename UpdateTag> std::vector<Sample<Key, Value, UpdateTag>>
+Reader<Key, Value, UpdateTag>::getAllLast() const noexcept
+{
+    auto all = _impl->getAllLast();
+    std::vector<Sample<Key, Value, UpdateTag>> samples;
+    samples.reserve(all.size());
+    for(const auto& sample : all)
+    {
+        samples.emplace_back(sample);
+    }
+    return samples;
+}
+
 template<typename Key, typename Value, typename UpdateTag> void
 Reader<Key, Value, UpdateTag>::onConnectedKeys(std::function<void(std::vector<Key>)> init,
                                                std::function<void(CallbackReason, Key)> update) noexcept
@@ -1465,12 +1712,29 @@ Reader<Key, Value, UpdateTag>::onSamples(std::function<void(std::vector<Sample<K
     } : std::function<void(const std::shared_ptr<DataStormI::Sample>&)>());
 }
 
+template<typename Key, typename Value, typename UpdateTag> void
+Reader<Key, Value, UpdateTag>::onSampleBatch(
+    std::function<void(const std::vector<Sample<Key, Value, UpdateTag>>&)> batch) noexcept
+{
+    _impl->onSampleBatch(batch ? [batch](const std::vector<std::shared_ptr<DataStormI::Sample>>& samplesI)
+    {
+        std::vector<Sample<Key, Value, UpdateTag>> samples;
+        samples.reserve(samplesI.size());
+        for(const auto& s : samplesI)
+        {
+            samples.emplace_back(s);
+        }
+        batch(samples);
+    } : std::function<void(const std::vector<std::shared_ptr<DataStormI::Sample>>&)>());
+}
+
 template<typename Key, typename Value, typename UpdateTag>
 SingleKeyReader<Key, Value, UpdateTag>::SingleKeyReader(const Topic<Key, Value, UpdateTag>& topic,
                                                         const Key& key,
                                                         const std::string& name,
                                                         const ReaderConfig& config) noexcept :
-    Reader<Key, Value, UpdateTag>(topic.getReader()->create({ topic._keyFactory->create(key) }, name, config))
+    Reader<Key, Value, UpdateTag>(topic.getReader()->create({ topic._keyFactory->create(key) }, name, config),
+                                  topic._keyFactory)
 {
 }
 
@@ -1485,7 +1749,8 @@ SingleKeyReader<Key, Value, UpdateTag>::SingleKeyReader(const Topic<Key, Value,
                                                             config,
                                                             sampleFilter.name,
                                                             DataStormI::EncoderT<SFC>::encode(topic.getCommunicator(),
-                                                                                              sampleFilter.criteria)))
+                                                                                              sampleFilter.criteria)),
+                                  topic._keyFactory)
 {
 }
 
@@ -1509,7 +1774,8 @@ MultiKeyReader<Key, Value, UpdateTag>::MultiKeyReader(const Topic<Key, Value, Up
                                                       const ReaderConfig& config) noexcept :
     Reader<Key, Value, UpdateTag>(topic.getReader()->create(topic._keyFactory->create(keys),
                                                             name,
-                                                            config))
+                                                            config),
+                                  topic._keyFactory)
 {
 }
 
@@ -1524,7 +1790,8 @@ MultiKeyReader<Key, Value, UpdateTag>::MultiKeyReader(const Topic<Key, Value, Up
                                                             config,
                                                             sampleFilter.name,
                                                             Encoder<SFC>::encode(topic.getCommunicator(),
-                                                                                 sampleFilter.criteria)))
+                                                                                 sampleFilter.criteria)),
+                                  topic._keyFactory)
 {
 }
 
@@ -1550,7 +1817,8 @@ FilteredKeyReader<Key, Value, UpdateTag>::FilteredKeyReader(const Topic<Key, Val
     Reader<Key, Value, UpdateTag>(topic.getReader()->createFiltered(topic._keyFilterFactories->create(filter.name,
                                                                                                       filter.criteria),
                                                                     name,
-                                                                    config))
+                                                                    config),
+                                  topic._keyFactory)
 {
 }
 
@@ -1566,7 +1834,8 @@ FilteredKeyReader<Key, Value, UpdateTag>::FilteredKeyReader(const Topic<Key, Val
                                                                     config,
                                                                     sampleFilter.name,
                                                                     Encoder<SFC>::encode(topic.getCommunicator(),
-                                                                                         sampleFilter.criteria)))
+                                                                                         sampleFilter.criteria)),
+                                  topic._keyFactory)
 {
 }
 
@@ -1672,6 +1941,12 @@ Writer<Key, Value, UpdateTag>::getAll() noexcept
     return samples;
 }
 
+template<typename Key, typename Value, typename UpdateTag> void
+Writer<Key, Value, UpdateTag>::flush() noexcept
+{
+    _impl->flush();
+}
+
 template<typename Key, typename Value, typename UpdateTag> void
 Writer<Key, Value, UpdateTag>::onConnectedKeys(std::function<void(std::vector<Key>)> init,
                                                std::function<void(CallbackReason, Key)> update) noexcept
@@ -1699,6 +1974,12 @@ Writer<Key, Value, UpdateTag>::onConnectedReaders(std::function<void(std::vector
     _impl->onConnectedElements(init, update);
 }
 
+template<typename Key, typename Value, typename UpdateTag> void
+Writer<Key, Value, UpdateTag>::onOverflow(std::function<void(std::string, bool)> callback) noexcept
+{
+    _impl->onOverflow(std::move(callback));
+}
+
 template<typename Key, typename Value, typename UpdateTag>
 SingleKeyWriter<Key, Value, UpdateTag>::SingleKeyWriter(const Topic<Key, Value, UpdateTag>& topic,
                                                         const Key& key,
@@ -1707,14 +1988,16 @@ SingleKeyWriter<Key, Value, UpdateTag>::SingleKeyWriter(const Topic<Key, Value,
     Writer<Key, Value, UpdateTag>(topic.getWriter()->create({ topic._keyFactory->create(key) },
                                                             name,
                                                             config)),
-    _tagFactory(topic._tagFactory)
+    _tagFactory(topic._tagFactory),
+    _sampleFactory(topic._sampleFactory)
 {
 }
 
 template<typename Key, typename Value, typename UpdateTag>
 SingleKeyWriter<Key, Value, UpdateTag>::SingleKeyWriter(SingleKeyWriter<Key, Value, UpdateTag>&& writer) noexcept :
     Writer<Key, Value, UpdateTag>(std::move(writer)),
-    _tagFactory(std::move(writer._tagFactory))
+    _tagFactory(std::move(writer._tagFactory)),
+    _sampleFactory(std::move(writer._sampleFactory))
 {
 }
 
@@ -1729,14 +2012,14 @@ template<typename Key, typename Value, typename UpdateTag> void
 SingleKeyWriter<Key, Value, UpdateTag>::add(const Value& value) noexcept
 {
    Writer<Key, Value, UpdateTag>::_impl->publish(nullptr,
-        std::make_shared<DataStormI::SampleT<Key, Value, UpdateTag>>(SampleEvent::Add, value));
+        _sampleFactory->create(SampleEvent::Add, value));
 }
 
 template<typename Key, typename Value, typename UpdateTag> void
 SingleKeyWriter<Key, Value, UpdateTag>::update(const Value& value) noexcept
 {
     Writer<Key, Value, UpdateTag>::_impl->publish(nullptr,
-        std::make_shared<DataStormI::SampleT<Key, Value, UpdateTag>>(SampleEvent::Update, value));
+        _sampleFactory->create(SampleEvent::Update, value));
 }
 
 template<typename Key, typename Value, typename UpdateTag>
@@ -1745,9 +2028,10 @@ SingleKeyWriter<Key, Value, UpdateTag>::partialUpdate(const UpdateTag& tag) noex
 {
     auto impl = Writer<Key, Value, UpdateTag>::_impl;
     auto updateTag = _tagFactory->create(tag);
-    return [impl, updateTag](const UpdateValue& value) {
+    auto sampleFactory = _sampleFactory;
+    return [impl, updateTag, sampleFactory](const UpdateValue& value) {
         auto encoded = Encoder<UpdateValue>::encode(impl->getCommunicator(), value);
-        impl->publish(nullptr, std::make_shared<DataStormI::SampleT<Key, Value, UpdateTag>>(encoded, updateTag));
+        impl->publish(nullptr, sampleFactory->create(std::move(encoded), updateTag));
     };
 }
 
@@ -1755,7 +2039,7 @@ template<typename Key, typename Value, typename UpdateTag> void
 SingleKeyWriter<Key, Value, UpdateTag>::remove() noexcept
 {
     Writer<Key, Value, UpdateTag>::_impl->publish(nullptr,
-        std::make_shared<DataStormI::SampleT<Key, Value, UpdateTag>>(SampleEvent::Remove));
+        _sampleFactory->create(SampleEvent::Remove));
 }
 
 template<typename Key, typename Value, typename UpdateTag>
@@ -1767,7 +2051,8 @@ MultiKeyWriter<Key, Value, UpdateTag>::MultiKeyWriter(const Topic<Key, Value, Up
                                                             name,
                                                             config)),
     _keyFactory(topic._keyFactory),
-    _tagFactory(topic._tagFactory)
+    _tagFactory(topic._tagFactory),
+    _sampleFactory(topic._sampleFactory)
 {
 }
 
@@ -1775,7 +2060,8 @@ template<typename Key, typename Value, typename UpdateTag>
 MultiKeyWriter<Key, Value, UpdateTag>::MultiKeyWriter(MultiKeyWriter<Key, Value, UpdateTag>&& writer) noexcept :
     Writer<Key, Value, UpdateTag>(std::move(writer)),
     _keyFactory(std::move(writer._keyFactory)),
-    _tagFactory(std::move(writer._tagFactory))
+    _tagFactory(std::move(writer._tagFactory)),
+    _sampleFactory(std::move(writer._sampleFactory))
 {
 }
 
@@ -1790,14 +2076,27 @@ template<typename Key, typename Value, typename UpdateTag> void
 MultiKeyWriter<Key, Value, UpdateTag>::add(const Key& key, const Value& value) noexcept
 {
     Writer<Key, Value, UpdateTag>::_impl->publish(_keyFactory->create(key),
-        std::make_shared<DataStormI::SampleT<Key, Value, UpdateTag>>(SampleEvent::Add, value));
+        _sampleFactory->create(SampleEvent::Add, value));
 }
 
 template<typename Key, typename Value, typename UpdateTag> void
 MultiKeyWriter<Key, Value, UpdateTag>::update(const Key& key, const Value& value) noexcept
 {
     Writer<Key, Value, UpdateTag>::_impl->publish(_keyFactory->create(key),
-        std::make_shared<DataStormI::SampleT<Key, Value, UpdateTag>>(SampleEvent::Update, value));
+        _sampleFactory->create(SampleEvent::Update, value));
+}
+
+template<typename Key, typename Value, typename UpdateTag> void
+MultiKeyWriter<Key, Value, UpdateTag>::update(const std::vector<std::pair<Key, Value>>& values) noexcept
+{
+    std::vector<std::pair<std::shared_ptr<DataStormI::Key>, std::shared_ptr<DataStormI::Sample>>> samples;
+    samples.reserve(values.size());
+    for(const auto& value : values)
+    {
+        samples.emplace_back(_keyFactory->create(value.first),
+                             _sampleFactory->create(SampleEvent::Update, value.second));
+    }
+    Writer<Key, Value, UpdateTag>::_impl->publish(samples);
 }
 
 template<typename Key, typename Value, typename UpdateTag>
@@ -1807,10 +2106,10 @@ MultiKeyWriter<Key, Value, UpdateTag>::partialUpdate(const UpdateTag& tag) noexc
     auto impl = Writer<Key, Value, UpdateTag>::_impl;
     auto updateTag = _tagFactory->create(tag);
     auto keyFactory = _keyFactory;
-    return [impl, updateTag, keyFactory](const Key& key, const UpdateValue& value) {
+    auto sampleFactory = _sampleFactory;
+    return [impl, updateTag, keyFactory, sampleFactory](const Key& key, const UpdateValue& value) {
         auto encoded = Encoder<UpdateValue>::encode(impl->getCommunicator(), value);
-        impl->publish(keyFactory->create(key),
-                      std::make_shared<DataStormI::SampleT<Key, Value, UpdateTag>>(encoded, updateTag));
+        impl->publish(keyFactory->create(key), sampleFactory->create(std::move(encoded), updateTag));
     };
 }
 
@@ -1818,7 +2117,63 @@ template<typename Key, typename Value, typename UpdateTag> void
 MultiKeyWriter<Key, Value, UpdateTag>::remove(const Key& key) noexcept
 {
     Writer<Key, Value, UpdateTag>::_impl->publish(_keyFactory->create(key),
-        std::make_shared<DataStormI::SampleT<Key, Value, UpdateTag>>(SampleEvent::Remove));
+        _sampleFactory->create(SampleEvent::Remove));
+}
+
+template<typename Key, typename Value, typename UpdateTag> KeyHandle<Key>
+MultiKeyWriter<Key, Value, UpdateTag>::getKeyHandle(const Key& key) const noexcept
+{
+    return KeyHandle<Key>(_keyFactory->create(key));
+}
+
+template<typename Key, typename Value, typename UpdateTag> void
+MultiKeyWriter<Key, Value, UpdateTag>::add(const KeyHandle<Key>& key, const Value& value) noexcept
+{
+    assert(key._impl);
+    Writer<Key, Value, UpdateTag>::_impl->publish(key._impl, _sampleFactory->create(SampleEvent::Add, value));
+}
+
+template<typename Key, typename Value, typename UpdateTag> void
+MultiKeyWriter<Key, Value, UpdateTag>::update(const KeyHandle<Key>& key, const Value& value) noexcept
+{
+    assert(key._impl);
+    Writer<Key, Value, UpdateTag>::_impl->publish(key._impl, _sampleFactory->create(SampleEvent::Update, value));
+}
+
+template<typename Key, typename Value, typename UpdateTag>
+template<typename UpdateValue> std::function<void(const UpdateValue&)>
+MultiKeyWriter<Key, Value, UpdateTag>::partialUpdate(const UpdateTag& tag, const KeyHandle<Key>& key) noexcept
+{
+    assert(key._impl);
+    auto impl = Writer<Key, Value, UpdateTag>::_impl;
+    auto updateTag = _tagFactory->create(tag);
+    auto keyImpl = key._impl;
+    auto sampleFactory = _sampleFactory;
+    return [impl, updateTag, keyImpl, sampleFactory](const UpdateValue& value) {
+        auto encoded = Encoder<UpdateValue>::encode(impl->getCommunicator(), value);
+        impl->publish(keyImpl, sampleFactory->create(std::move(encoded), updateTag));
+    };
+}
+
+template<typename Key, typename Value, typename UpdateTag> void
+MultiKeyWriter<Key, Value, UpdateTag>::remove(const KeyHandle<Key>& key) noexcept
+{
+    assert(key._impl);
+    Writer<Key, Value, UpdateTag>::_impl->publish(key._impl, _sampleFactory->create(SampleEvent::Remove));
+}
+
+//
+// KeyHandle template implementation
+//
+template<typename Key> const Key&
+KeyHandle<Key>::getKey() const noexcept
+{
+    return std::static_pointer_cast<DataStormI::KeyT<Key>>(_impl)->get();
+}
+
+template<typename Key>
+KeyHandle<Key>::KeyHandle(std::shared_ptr<DataStormI::Key> impl) noexcept : _impl(std::move(impl))
+{
 }
 
 #if !defined(__clang__) && defined(__GNUC__) && ((__GNUC__* 100) + __GNUC_MINOR__) < 490
@@ -1853,8 +2208,79 @@ private:
     regex_t _expr;
 };
 
+#else
+
+/** @private */
+class RegexMatcher
+{
+public:
+
+    RegexMatcher(const std::string& criteria)
+    {
+        //
+        // Regular expressions without special characters or only ending with `.*' are matched
+        // with a string comparison rather than with the regex engine.
+        //
+        auto pos = criteria.find_first_of("\\^$.|?*+()[]{}");
+        if(pos == std::string::npos)
+        {
+            _kind = Kind::Literal;
+            _literal = criteria;
+        }
+        else if(pos + 2 == criteria.size() && criteria.compare(pos, 2, ".*") == 0)
+        {
+            _kind = Kind::Prefix;
+            _literal = criteria.substr(0, pos);
+        }
+        else
+        {
+            _kind = Kind::Regex;
+            _expr = std::regex(criteria);
+        }
+    }
+
+    bool match(const std::string& value) const
+    {
+        switch(_kind)
+        {
+        case Kind::Literal:
+            return value == _literal;
+        case Kind::Prefix:
+            // `.' doesn't match line terminators
+            return value.compare(0, _literal.size(), _literal) == 0 &&
+                   value.find_first_of("\r\n", _literal.size()) == std::string::npos;
+        default:
+            return std::regex_match(value, _expr);
+        }
+    }
+
+private:
+
+    enum class Kind { Literal, Prefix, Regex };
+
+    Kind _kind;
+    std::string _literal;
+    std::regex _expr;
+};
+
 #endif
 
+/** @private */
+template<typename Value> std::string
+toFilterString(const Value& value)
+{
+    std::ostringstream os;
+    os << value;
+    return os.str();
+}
+
+/** @private */
+inline const std::string&
+toFilterString(const std::string& value)
+{
+    return value;
+}
+
 /** @private */
 template<typename Value> std::function<std::function<bool (const Value&)> (const std::string&)>
 makeRegexFilter() noexcept
@@ -1863,21 +2289,27 @@ makeRegexFilter() noexcept
     {
 #if !defined(__clang__) && defined(__GNUC__) && ((__GNUC__* 100) + __GNUC_MINOR__) < 490
         auto expr = std::make_shared<RegExp>(criteria);
+#else
+        auto expr = std::make_shared<RegexMatcher>(criteria);
+#endif
         return [expr](const Value& value)
         {
-            std::ostringstream os;
-            os << value;
-            return expr->match(os.str());
+            return expr->match(toFilterString(value));
         };
-#else
-        std::regex expr(criteria);
-        return [expr](const Value& value)
+    };
+}
+
+/** @private */
+template<typename Value> std::function<std::function<bool (const Value&)> (const std::string&)>
+makePrefixFilter() noexcept
+{
+    return [](const std::string& prefix)
+    {
+        return [prefix](const Value& value)
         {
-            std::ostringstream os;
-            os << value;
-            return std::regex_match(os.str(), expr);
+            const std::string& str = toFilterString(value);
+            return str.compare(0, prefix.size(), prefix) == 0;
         };
-#endif
     };
 }
 
@@ -1912,7 +2344,9 @@ struct RegexFilter<T, V, typename std::enable_if<DataStormI::is_streamable<V>::v
     template<typename F> static void
     add(F factory)
     {
-        factory->set("_regex", makeRegexFilter<T>()); // Only set the _regex filter if the value is streamable
+        // Only set the _regex and _prefix filters if the value is streamable
+        factory->set("_regex", makeRegexFilter<T>());
+        factory->set("_prefix", makePrefixFilter<T>());
     }
 };
 
@@ -1925,6 +2359,7 @@ Topic<Key, Value, UpdateTag>::Topic(const Node& node, const std::string& name) n
     _topicFactory(node._factory),
     _keyFactory(DataStormI::KeyFactoryT<Key>::createFactory()),
     _tagFactory(DataStormI::TagFactoryT<UpdateTag>::createFactory()),
+    _sampleFactory(std::make_shared<DataStormI::SampleFactoryT<Key, Value, UpdateTag>>()),
     _keyFilterFactories(DataStormI::FilterManagerT<DataStormI::KeyT<Key>>::create()),
     _sampleFilterFactories(DataStormI::FilterManagerT<DataStormI::SampleT<Key, Value, UpdateTag>>::create())
 {
@@ -1939,6 +2374,7 @@ Topic<Key, Value, UpdateTag>::Topic(Topic<Key, Value, UpdateTag>&& topic) noexce
     _topicFactory(std::move(topic._topicFactory)),
     _keyFactory(std::move(topic._keyFactory)),
     _tagFactory(std::move(topic._tagFactory)),
+    _sampleFactory(std::move(topic._sampleFactory)),
     _keyFilterFactories(std::move(topic._keyFilterFactories)),
     _sampleFilterFactories(std::move(topic._sampleFilterFactories)),
     _reader(std::move(topic._reader)),
@@ -1977,6 +2413,7 @@ Topic<Key, Value, UpdateTag>::operator=(Topic<Key, Value, UpdateTag>&& topic) no
     _topicFactory = std::move(topic._topicFactory);
     _keyFactory = std::move(topic._keyFactory);
     _tagFactory = std::move(topic._tagFactory);
+    _sampleFactory = std::move(topic._sampleFactory);
     _keyFilterFactories = std::move(topic._keyFilterFactories);
     _sampleFilterFactories = std::move(topic._sampleFilterFactories);
     _reader = std::move(topic._reader);
@@ -2095,8 +2532,7 @@ Topic<Key, Value, UpdateTag>::getReader() const noexcept
     std::lock_guard<std::mutex> lock(_mutex);
     if(!_reader)
     {
-        auto sampleFactory = std::make_shared<DataStormI::SampleFactoryT<Key, Value, UpdateTag>>();
-        _reader = _topicFactory->createTopicReader(_name, _keyFactory, _tagFactory, sampleFactory, _keyFilterFactories,
+        _reader = _topicFactory->createTopicReader(_name, _keyFactory, _tagFactory, _sampleFactory, _keyFilterFactories,
                                                    _sampleFilterFactories);
         _reader->setUpdaters(_writer ? _writer->getUpdaters() : _updaters);
         _updaters.clear();
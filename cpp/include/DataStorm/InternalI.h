@@ -36,6 +36,12 @@ public:
 
 class Key : public Filterable, virtual public Element
 {
+public:
+
+    //
+    // Returns the string form of the key value matched by the built-in `_prefix' key filter.
+    //
+    virtual std::string toPrefixString() const = 0;
 };
 
 class KeyFactory
@@ -86,6 +92,13 @@ public:
     virtual void setValue(const std::shared_ptr<Sample>&) = 0;
 
     virtual void decode(const std::shared_ptr<Ice::Communicator>&) = 0;
+
+    //
+    // Set the decoder of a lazily decoded sample. The decoder is called once to decode the value or
+    // to apply the partial update when the sample value is first accessed.
+    //
+    virtual void setLazyDecoder(std::function<void(const std::shared_ptr<Sample>&)>) = 0;
+
     virtual const std::vector<unsigned char>& encode(const std::shared_ptr<Ice::Communicator>&) = 0;
     virtual std::vector<unsigned char> encodeValue(const std::shared_ptr<Ice::Communicator>&) = 0;
 
@@ -94,6 +107,11 @@ public:
         return _encodedValue;
     }
 
+    void setEncodedValue(std::vector<unsigned char> value)
+    {
+        _encodedValue = std::move(value);
+    }
+
     std::string session;
     std::string origin;
     long long int id;
@@ -119,7 +137,7 @@ public:
                                            DataStorm::SampleEvent,
                                            const std::shared_ptr<Key>&,
                                            const std::shared_ptr<Tag>&,
-                                           std::vector<unsigned char>,
+                                           const std::vector<unsigned char>&,
                                            long long int) = 0;
 };
 
@@ -129,6 +147,12 @@ public:
 
     virtual bool match(const std::shared_ptr<Filterable>&) const = 0;
     virtual const std::string& getName() const = 0;
+
+    //
+    // Returns true and sets the prefix if the filter is the built-in `_prefix' filter, the topic
+    // indexes the prefix key filters to match keys without evaluating each filter.
+    //
+    virtual bool getPrefix(std::string&) const = 0;
 };
 
 class FilterFactory
@@ -181,12 +205,17 @@ public:
     virtual int getInstanceCount() const = 0;
 
     virtual std::vector<std::shared_ptr<Sample>> getAllUnread() = 0;
+    virtual void takeUnread(size_t, std::vector<std::shared_ptr<Sample>>&) = 0;
     virtual void waitForUnread(unsigned int) const = 0;
     virtual bool hasUnread() const = 0;
     virtual std::shared_ptr<Sample> getNextUnread() = 0;
 
+    virtual std::shared_ptr<Sample> getLast(const std::shared_ptr<Key>&) const = 0;
+    virtual std::vector<std::shared_ptr<Sample>> getAllLast() const = 0;
+
     virtual void onSamples(std::function<void(const std::vector<std::shared_ptr<Sample>>&)>,
                            std::function<void(const std::shared_ptr<Sample>&)>) = 0;
+    virtual void onSampleBatch(std::function<void(const std::vector<std::shared_ptr<Sample>>&)>) = 0;
 };
 
 class DataWriter : virtual public DataElement
@@ -200,6 +229,10 @@ public:
     virtual std::vector<std::shared_ptr<Sample>> getAll() const = 0;
 
     virtual void publish(const std::shared_ptr<Key>&, const std::shared_ptr<Sample>&) = 0;
+    virtual void publish(const std::vector<std::pair<std::shared_ptr<Key>, std::shared_ptr<Sample>>>&) = 0;
+    virtual void flush() = 0;
+
+    virtual void onOverflow(std::function<void(std::string, bool)>) = 0;
 };
 
 class Topic
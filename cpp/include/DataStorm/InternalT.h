@@ -10,6 +10,12 @@
 
 #include <Ice/Ice.h>
 
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
 namespace DataStorm
 {
 
@@ -114,6 +120,15 @@ template<typename T> struct Stringifier<T, typename std::enable_if<is_streamable
     }
 };
 
+template<> struct Stringifier<std::string>
+{
+    static const std::string&
+    toString(const std::string& value)
+    {
+        return value;
+    }
+};
+
 template<typename T> class AbstractElementT : virtual public Element
 {
 public:
@@ -151,8 +166,57 @@ protected:
     const long long int _id;
 };
 
+template<typename T>
+class is_hashable
+{
+    template<typename TT>
+    static auto test(int) -> decltype(std::hash<TT>()(std::declval<const TT&>()),
+                                      std::declval<const TT&>() == std::declval<const TT&>(),
+                                      std::true_type());
+
+    template<typename>
+    static auto test(...) -> std::false_type;
+
+public:
+
+    static const bool value = decltype(test<T>(0))::value;
+};
+
+//
+// The factory traits define the container used to index the factory elements by value. Elements
+// with hashable values are stored in hash maps striped over multiple shards, each shard being
+// protected by its own mutex. Other elements are stored in a single ordered map.
+//
+template<typename K, typename Enabler=void> struct FactoryTraitsT
+{
+    template<typename V> using ElementMap = std::map<K, std::weak_ptr<V>>;
+
+    static const size_t shardCount = 1;
+
+    static size_t shard(const K&)
+    {
+        return 0;
+    }
+};
+
+template<typename K> struct FactoryTraitsT<K, typename std::enable_if<is_hashable<K>::value>::type>
+{
+    template<typename V> using ElementMap = std::unordered_map<K, std::weak_ptr<V>>;
+
+    static const size_t shardCount = 16;
+
+    static size_t shard(const K& value)
+    {
+        // Use the high bits of the mixed hash, the low bits are used by the shard hash map.
+        return static_cast<size_t>((static_cast<unsigned long long int>(std::hash<K>()(value)) *
+                                    0x9E3779B97F4A7C15ULL) >> 60);
+    }
+};
+
 template<typename K, typename V> class AbstractFactoryT : public std::enable_shared_from_this<AbstractFactoryT<K, V>>
 {
+    using Traits = FactoryTraitsT<K>;
+
     struct Deleter
     {
         void operator()(V* obj)
@@ -169,6 +233,20 @@ template<typename K, typename V> class AbstractFactoryT : public std::enable_sha
 
     } _deleter;
 
+    struct ElementShard
+    {
+        std::mutex mutex;
+        typename Traits::template ElementMap<V> elements;
+    };
+
+    struct IdShard
+    {
+        std::mutex mutex;
+        std::unordered_map<long long int, std::weak_ptr<V>> elements;
+    };
+
+    static const size_t idShardCount = 16;
+
 public:
 
     AbstractFactoryT() : _nextId(1)
@@ -184,15 +262,14 @@ public:
     template<typename F, typename... Args> std::shared_ptr<typename V::BaseClassType>
     create(F&& value, Args&&... args)
     {
-        std::lock_guard<std::mutex> lock(_mutex);
         return createImpl(std::forward<F>(value), std::forward<Args>(args)...);
     }
 
     std::vector<std::shared_ptr<typename V::BaseClassType>>
     create(std::vector<K> values)
     {
-        std::lock_guard<std::mutex> lock(_mutex);
         std::vector<std::shared_ptr<typename V::BaseClassType>> seq;
+        seq.reserve(values.size());
         for(auto& v : values)
         {
             seq.push_back(createImpl(std::move(v)));
@@ -207,9 +284,10 @@ protected:
     std::shared_ptr<typename V::BaseClassType>
     getImpl(long long id) const
     {
-        std::lock_guard<std::mutex> lock(_mutex);
-        auto p = _elementsById.find(id);
-        if(p != _elementsById.end())
+        auto& shard = _idShards[static_cast<size_t>(id) % idShardCount];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto p = shard.elements.find(id);
+        if(p != shard.elements.end())
         {
             auto k = p->second.lock();
             if(k)
@@ -223,8 +301,11 @@ protected:
     template<typename F, typename... Args> std::shared_ptr<V>
     createImpl(F&& value, Args&&... args)
     {
-        auto p = _elements.find(value);
-        if(p != _elements.end())
+        const K& key = value;
+        auto& shard = _shards[Traits::shard(key)];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto p = shard.elements.find(key);
+        if(p != shard.elements.end())
         {
             auto k = p->second.lock();
             if(k)
@@ -237,37 +318,49 @@ protected:
             // to allow the insertion of a new key. The deleter won't remove the
             // new key.
             //
-            _elements.erase(p);
+            shard.elements.erase(p);
         }
 
         auto k = std::shared_ptr<V>(new V(std::forward<F>(value), std::forward<Args>(args)..., ++_nextId), _deleter);
-        _elements[k->get()] = k;
-        _elementsById[k->getId()] = k;
+        shard.elements.emplace(k->get(), k);
+
+        auto& idShard = _idShards[static_cast<size_t>(k->getId()) % idShardCount];
+        std::lock_guard<std::mutex> idLock(idShard.mutex);
+        idShard.elements.emplace(k->getId(), k);
         return k;
     }
 
     void remove(V* v)
     {
-        // Make sure to declare the variable outside the synchronization in case the element needs
-        // to be deleted if it's not the same.
-        std::shared_ptr<V> e;
-        std::lock_guard<std::mutex> lock(_mutex);
-        auto p = _elements.find(v->get());
-        if(p != _elements.end())
         {
-            e = p->second.lock();
-            if(e && e.get() == v)
+            // Make sure to declare the variable outside the synchronization in case the element needs
+            // to be deleted if it's not the same.
+            std::shared_ptr<V> e;
+            auto& shard = _shards[Traits::shard(v->get())];
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto p = shard.elements.find(v->get());
+            if(p != shard.elements.end())
             {
-                _elements.erase(p);
+                //
+                // The element being deleted is expired. If the element is still alive, it's a new
+                // element created for the same value after this element expired.
+                //
+                e = p->second.lock();
+                if(!e)
+                {
+                    shard.elements.erase(p);
+                }
             }
         }
-        _elementsById.erase(v->getId());
+
+        auto& idShard = _idShards[static_cast<size_t>(v->getId()) % idShardCount];
+        std::lock_guard<std::mutex> lock(idShard.mutex);
+        idShard.elements.erase(v->getId());
     }
 
-    mutable std::mutex _mutex;
-    std::map<K, std::weak_ptr<V>> _elements;
-    std::map<long long int, std::weak_ptr<V>> _elementsById;
-    long long int _nextId;
+    std::array<ElementShard, Traits::shardCount> _shards;
+    mutable std::array<IdShard, idShardCount> _idShards;
+    std::atomic<long long int> _nextId;
 };
 
 template<typename K> class KeyT : public Key, public AbstractElementT<K>
@@ -279,6 +372,11 @@ public:
         return "k" + AbstractElementT<K>::toString();
     }
 
+    virtual std::string toPrefixString() const override
+    {
+        return Stringifier<K>::toString(this->_value);
+    }
+
     using AbstractElementT<K>::AbstractElementT;
     using BaseClassType = Key;
 };
@@ -348,6 +446,170 @@ public:
     }
 };
 
+//
+// Per-thread free list of recycled items. Each thread keeps up to maxSize items, an item released by a thread
+// other than the thread which obtained it is added to the free list of the releasing thread. The free lists
+// don't require any synchronization. The Tag parameter allows to keep separate free lists for items of the
+// same type, the sample blocks use the block size.
+//
+template<typename T, size_t Tag, size_t maxSize = 256> class FreeListT
+{
+public:
+
+    static bool pop(T& item)
+    {
+        auto items = get();
+        if(!items || items->empty())
+        {
+            return false;
+        }
+        item = std::move(items->back());
+        items->pop_back();
+        return true;
+    }
+
+    static bool push(T& item)
+    {
+        auto items = get();
+        if(!items || items->size() >= maxSize)
+        {
+            return false;
+        }
+        items->push_back(std::move(item));
+        return true;
+    }
+
+private:
+
+    struct Holder
+    {
+        Holder(bool& destroyed) : destroyed(destroyed)
+        {
+            items.reserve(maxSize);
+        }
+
+        ~Holder()
+        {
+            destroyed = true;
+        }
+
+        bool& destroyed;
+        std::vector<T> items;
+    };
+
+    static std::vector<T>* get()
+    {
+        //
+        // Samples can still be released by a thread once its free list is destroyed, the flag is trivially
+        // destructible and can be checked until the thread terminates.
+        //
+        static thread_local bool destroyed = false;
+        if(destroyed)
+        {
+            return nullptr;
+        }
+        static thread_local Holder holder(destroyed);
+        return &holder.items;
+    }
+};
+
+struct SampleBlockDeleter
+{
+    void operator()(void* block) const
+    {
+        ::operator delete(block);
+    }
+};
+
+using SampleBlock = std::unique_ptr<void, SampleBlockDeleter>;
+
+//
+// Encoded value buffers larger than this size aren't recycled.
+//
+const size_t maxRecycledValueSize = 64 * 1024;
+
+//
+// Returns a copy of the given encoded value, the copy uses a recycled buffer if one is available.
+//
+inline std::vector<unsigned char>
+copyEncodedValue(const std::vector<unsigned char>& value)
+{
+    std::vector<unsigned char> buffer;
+    if(!value.empty())
+    {
+        FreeListT<std::vector<unsigned char>, 0>::pop(buffer);
+        buffer.assign(value.begin(), value.end());
+    }
+    return buffer;
+}
+
+//
+// Releases the buffer of the given encoded value, the value is empty once released.
+//
+inline void
+releaseEncodedValue(std::vector<unsigned char>& value)
+{
+    if(value.capacity() > 0 && value.capacity() <= maxRecycledValueSize)
+    {
+        value.clear();
+        if(FreeListT<std::vector<unsigned char>, 0>::push(value))
+        {
+            return;
+        }
+    }
+    std::vector<unsigned char>().swap(value);
+}
+
+//
+// The sample pool allocator recycles the memory blocks of the samples created by a topic sample factory. The
+// samples are allocated with std::allocate_shared so that the sample and its shared_ptr control block are stored
+// in a single block. Free blocks are kept in per-thread free lists.
+//
+template<typename T> class SamplePoolAllocatorT
+{
+public:
+
+    using value_type = T;
+
+    SamplePoolAllocatorT() = default;
+
+    template<typename U> SamplePoolAllocatorT(const SamplePoolAllocatorT<U>&)
+    {
+    }
+
+    T* allocate(size_t count)
+    {
+        if(count == 1)
+        {
+            SampleBlock block;
+            if(FreeListT<SampleBlock, sizeof(T)>::pop(block))
+            {
+                return static_cast<T*>(block.release());
+            }
+        }
+        return static_cast<T*>(::operator new(count * sizeof(T)));
+    }
+
+    void deallocate(T* value, size_t count)
+    {
+        SampleBlock block(value);
+        if(count == 1)
+        {
+            FreeListT<SampleBlock, sizeof(T)>::push(block);
+        }
+    }
+
+    template<typename U> bool operator==(const SamplePoolAllocatorT<U>&) const
+    {
+        return true;
+    }
+
+    template<typename U> bool operator!=(const SamplePoolAllocatorT<U>&) const
+    {
+        return false;
+    }
+};
+
 template<typename Key, typename Value, typename UpdateTag> class SampleT :
     public Sample, public std::enable_shared_from_this<SampleT<Key, Value, UpdateTag>>
 {
@@ -361,21 +623,28 @@ public:
             const std::shared_ptr<DataStormI::Tag>& tag,
             std::vector<unsigned char> value,
             long long int timestamp) :
-        Sample(session, origin, id, event, key, tag, value, timestamp), _hasValue(false)
+        Sample(session, origin, id, event, key, tag, std::move(value), timestamp), _hasValue(false), _lazy(false)
     {
     }
 
-    SampleT(DataStorm::SampleEvent event) : Sample(event), _hasValue(false)
+    ~SampleT()
     {
+        releaseEncodedValue(_encodedValue);
     }
 
-    SampleT(DataStorm::SampleEvent event, Value value) : Sample(event), _hasValue(true), _value(std::move(value))
+    SampleT(DataStorm::SampleEvent event) : Sample(event), _hasValue(false), _lazy(false)
+    {
+    }
+
+    SampleT(DataStorm::SampleEvent event, Value value) :
+        Sample(event), _hasValue(true), _value(std::move(value)), _lazy(false)
     {
     }
 
     SampleT(std::vector<unsigned char> value, const std::shared_ptr<Tag>& tag) :
         Sample(DataStorm::SampleEvent::PartialUpdate, tag),
-        _hasValue(false)
+        _hasValue(false),
+        _lazy(false)
     {
         _encodedValue = std::move(value);
     }
@@ -395,6 +664,7 @@ public:
 
     const Value& getValue() const
     {
+        resolve();
         return _value;
     }
 
@@ -406,12 +676,18 @@ public:
     void setValue(Value value)
     {
         _value = std::move(value);
-        _hasValue = true;
+        _hasValue.store(true, std::memory_order_release);
     }
 
     virtual bool hasValue() const override
     {
-        return _hasValue;
+        return _hasValue.load(std::memory_order_acquire) || _lazy.load(std::memory_order_acquire);
+    }
+
+    virtual void setLazyDecoder(std::function<void(const std::shared_ptr<Sample>&)> decoder) override
+    {
+        _decoder = std::move(decoder);
+        _lazy.store(true, std::memory_order_release);
     }
 
     virtual void setValue(const std::shared_ptr<Sample>& sample) override
@@ -425,7 +701,7 @@ public:
         {
             _value = Value();
         }
-        _hasValue = true;
+        _hasValue.store(true, std::memory_order_release);
     }
 
     virtual const std::vector<unsigned char>& encode(const std::shared_ptr<Ice::Communicator>& communicator) override
@@ -439,7 +715,8 @@ public:
 
     virtual std::vector<unsigned char> encodeValue(const std::shared_ptr<Ice::Communicator>& communicator) override
     {
-        assert(_hasValue || event == DataStorm::SampleEvent::Remove);
+        resolve();
+        assert(_hasValue.load(std::memory_order_acquire) || event == DataStorm::SampleEvent::Remove);
         return EncoderT<Value>::encode(communicator, _value);
     }
 
@@ -447,20 +724,49 @@ public:
     {
         if(!_encodedValue.empty())
         {
-            _hasValue = true;
             _value = DecoderT<Value>::decode(communicator, _encodedValue);
-            _encodedValue.clear();
+            releaseEncodedValue(_encodedValue);
+            _hasValue.store(true, std::memory_order_release);
         }
     }
 
 private:
 
-    bool _hasValue;
+    void resolve() const
+    {
+        //
+        // The decoder of a lazily decoded sample is called once, by the first thread accessing the
+        // value. It's released once called to release the previous sample of a partial update.
+        //
+        if(_lazy.load(std::memory_order_acquire))
+        {
+            std::call_once(_resolved, [this]
+            {
+                auto self = std::const_pointer_cast<SampleT<Key, Value, UpdateTag>>(
+                    std::enable_shared_from_this<SampleT<Key, Value, UpdateTag>>::shared_from_this());
+                _decoder(self);
+                _decoder = nullptr;
+                _lazy.store(false, std::memory_order_release);
+            });
+        }
+    }
+
+    //
+    // The value flag is set by the lazy decoder on the thread resolving the sample and is checked by
+    // hasValue() on other threads, it's only set once the value is assigned.
+    //
+    std::atomic<bool> _hasValue;
     Value _value;
+
+    mutable std::atomic<bool> _lazy;
+    mutable std::once_flag _resolved;
+    mutable std::function<void(const std::shared_ptr<Sample>&)> _decoder;
 };
 
 template<typename Key, typename Value, typename UpdateTag> class SampleFactoryT : public SampleFactory
 {
+    using SampleType = SampleT<Key, Value, UpdateTag>;
+
 public:
 
     virtual std::shared_ptr<Sample> create(const std::string& session,
@@ -469,17 +775,33 @@ public:
                                            DataStorm::SampleEvent type,
                                            const std::shared_ptr<DataStormI::Key>& key,
                                            const std::shared_ptr<DataStormI::Tag>& tag,
-                                           std::vector<unsigned char> value,
-                                           long long int timestamp)
-    {
-        return std::make_shared<SampleT<Key, Value, UpdateTag>>(session,
-                                                                origin,
-                                                                id,
-                                                                type,
-                                                                key,
-                                                                tag,
-                                                                std::move(value),
-                                                                timestamp);
+                                           const std::vector<unsigned char>& value,
+                                           long long int timestamp) override
+    {
+        return std::allocate_shared<SampleType>(SamplePoolAllocatorT<SampleType>(),
+                                                session,
+                                                origin,
+                                                id,
+                                                type,
+                                                key,
+                                                tag,
+                                                copyEncodedValue(value),
+                                                timestamp);
+    }
+
+    std::shared_ptr<SampleType> create(DataStorm::SampleEvent event)
+    {
+        return std::allocate_shared<SampleType>(SamplePoolAllocatorT<SampleType>(), event);
+    }
+
+    std::shared_ptr<SampleType> create(DataStorm::SampleEvent event, const Value& value)
+    {
+        return std::allocate_shared<SampleType>(SamplePoolAllocatorT<SampleType>(), event, value);
+    }
+
+    std::shared_ptr<SampleType> create(std::vector<unsigned char> value, const std::shared_ptr<Tag>& tag)
+    {
+        return std::allocate_shared<SampleType>(SamplePoolAllocatorT<SampleType>(), std::move(value), tag);
     }
 };
 
@@ -499,7 +821,7 @@ public:
 
     virtual bool match(const std::shared_ptr<Filterable>& value) const override
     {
-        return _lambda(std::static_pointer_cast<V>(value)->get());
+        return matchImpl(std::static_pointer_cast<V>(value), std::is_base_of<Key, V>());
     }
 
     virtual const std::string& getName() const override
@@ -507,6 +829,11 @@ public:
         return _name;
     }
 
+    virtual bool getPrefix(std::string& prefix) const override
+    {
+        return getPrefixImpl(prefix, std::is_same<C, std::string>());
+    }
+
     template<typename FF> void
     init(const std::string& name, FF&& lambda)
     {
@@ -518,8 +845,60 @@ public:
 
 private:
 
+    bool getPrefixImpl(std::string&, std::false_type) const
+    {
+        return false;
+    }
+
+    bool getPrefixImpl(std::string& prefix, std::true_type) const
+    {
+        if(_name == "_prefix")
+        {
+            prefix = this->_value;
+            return true;
+        }
+        return false;
+    }
+
+    bool matchImpl(const std::shared_ptr<V>& value, std::false_type) const
+    {
+        return _lambda(value->get());
+    }
+
+    bool matchImpl(const std::shared_ptr<V>& key, std::true_type) const
+    {
+        //
+        // Keys are immutable so the result of matching a key is cached by key id. Key filters are
+        // evaluated for each element of the topic with the same key when elements are attached.
+        //
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto p = _matches.find(key->getId());
+            if(p != _matches.end())
+            {
+                return p->second;
+            }
+        }
+
+        bool match = _lambda(key->get());
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        if(_matches.size() >= maxKeyMatches)
+        {
+            _matches.clear();
+        }
+        _matches.emplace(key->getId(), match);
+        return match;
+    }
+
+    // The maximum number of key match results cached by a key filter.
+    static const size_t maxKeyMatches = 4096;
+
     std::string _name;
     std::function<bool(const typename std::remove_reference<decltype(std::declval<V>().get())>::type&)> _lambda;
+
+    mutable std::mutex _mutex;
+    mutable std::unordered_map<long long int, bool> _matches;
 };
 
 template<typename C, typename V> class FilterFactoryT : public FilterFactory, public AbstractFactoryT<C, FilterT<C, V>>
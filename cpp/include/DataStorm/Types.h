@@ -56,6 +56,51 @@ enum struct ClearHistoryPolicy
     Never
 };
 
+/**
+ * The compression specifies how writers compress sample values.
+ */
+enum struct Compression
+{
+    /** Sample values are not compressed. */
+    None,
+
+    /** Sample values are compressed with zlib. */
+    Zlib
+};
+
+/**
+ * The overflow policy specifies what a writer does when a reader exceeds the
+ * writer high-water mark.
+ */
+enum struct OverflowPolicy
+{
+    /**
+     * Publishing a sample for the reader blocks until the requests queued for
+     * the reader are sent. Samples for other readers are not blocked.
+     */
+    Block,
+
+    /**
+     * Samples for the reader are queued by the writer, when the queue exceeds
+     * the high-water mark the oldest queued updates superseded by a newer
+     * update with the same key are dropped first, then the oldest queued
+     * updates which are the last queued sample of their key. Other samples
+     * are never dropped, if the queue still exceeds the high-water mark the
+     * queue is discarded and the connection with the reader is closed.
+     */
+    DropOldest,
+
+    /** The connection with the reader is closed. */
+    Disconnect,
+
+    /**
+     * Samples for the reader are queued by the writer and conflated by key,
+     * a queued sample is replaced by the newest sample with the same key.
+     * Partial updates are replaced by an update with the updated value.
+     */
+    Conflate
+};
+
 /**
  * The configuration base class holds configuration options common to readers and
  * writers.
@@ -130,13 +175,22 @@ public:
      * @param sampleLifetime The optional sample lifetime.
      * @param clearHistory The optional clear history policy.
      * @param discardPolicy The discard policy.
+     * @param minSampleInterval The optional minimum sample interval.
+     * @param lazyDecode The optional lazy decode configuration.
+     * @param lastValueCache The optional last value cache configuration.
      */
     ReaderConfig(Ice::optional<int> sampleCount = Ice::nullopt,
                  Ice::optional<int> sampleLifetime = Ice::nullopt,
                  Ice::optional<ClearHistoryPolicy> clearHistory = Ice::nullopt,
-                 Ice::optional<DiscardPolicy> discardPolicy = Ice::nullopt) noexcept :
+                 Ice::optional<DiscardPolicy> discardPolicy = Ice::nullopt,
+                 Ice::optional<int> minSampleInterval = Ice::nullopt,
+                 Ice::optional<bool> lazyDecode = Ice::nullopt,
+                 Ice::optional<bool> lastValueCache = Ice::nullopt) noexcept :
         Config(std::move(sampleCount), std::move(sampleLifetime), std::move(clearHistory)),
-        discardPolicy(std::move(discardPolicy))
+        discardPolicy(std::move(discardPolicy)),
+        minSampleInterval(std::move(minSampleInterval)),
+        lazyDecode(std::move(lazyDecode)),
+        lastValueCache(std::move(lastValueCache))
     {
     }
 
@@ -145,6 +199,33 @@ public:
      * reader.
      */
     Ice::optional<DiscardPolicy> discardPolicy;
+
+    /**
+     * The minimum sample interval specifies in milliseconds the minimum time
+     * between two samples of the same key sent by a writer to the reader.
+     * Updates published by the writer within the interval are not sent, the
+     * writer sends the latest update once the interval elapsed. Add and
+     * remove samples are always sent. The interval is enforced by the writer
+     * only if all the readers of the node attached to the writer have a
+     * minimum sample interval.
+     */
+    Ice::optional<int> minSampleInterval;
+
+    /**
+     * The lazyDecode configuration specifies if the reader decodes the sample
+     * values when the value is first accessed rather than when the samples are
+     * received. Partial updates are also applied when the value is first
+     * accessed. The default is false.
+     */
+    Ice::optional<bool> lazyDecode;
+
+    /**
+     * The lastValueCache configuration specifies if the reader keeps the last
+     * sample received for each key. The last sample of a key is kept until a
+     * remove sample is received for the key, independently of the sample
+     * history configuration. The default is false.
+     */
+    Ice::optional<bool> lastValueCache;
 };
 
 /**
@@ -169,13 +250,37 @@ public:
      * @param sampleLifetime The optional sample lifetime.
      * @param clearHistory The optional clear history policy.
      * @param priority The writer priority.
+     * @param flushInterval The optional flush interval.
+     * @param flushSize The optional flush size.
+     * @param deltaKeyFrameInterval The optional delta key frame interval.
+     * @param compression The optional compression.
+     * @param compressionThreshold The optional compression threshold.
+     * @param highWaterMark The optional high-water mark.
+     * @param highWaterMarkBytes The optional high-water mark in bytes.
+     * @param overflowPolicy The optional overflow policy.
      */
     WriterConfig(Ice::optional<int> sampleCount = Ice::nullopt,
                  Ice::optional<int> sampleLifetime  = Ice::nullopt,
                  Ice::optional<ClearHistoryPolicy> clearHistory = Ice::nullopt,
-                 Ice::optional<int> priority = Ice::nullopt) noexcept :
+                 Ice::optional<int> priority = Ice::nullopt,
+                 Ice::optional<int> flushInterval = Ice::nullopt,
+                 Ice::optional<int> flushSize = Ice::nullopt,
+                 Ice::optional<int> deltaKeyFrameInterval = Ice::nullopt,
+                 Ice::optional<Compression> compression = Ice::nullopt,
+                 Ice::optional<int> compressionThreshold = Ice::nullopt,
+                 Ice::optional<int> highWaterMark = Ice::nullopt,
+                 Ice::optional<int> highWaterMarkBytes = Ice::nullopt,
+                 Ice::optional<OverflowPolicy> overflowPolicy = Ice::nullopt) noexcept :
         Config(std::move(sampleCount), std::move(sampleLifetime), std::move(clearHistory)),
-        priority(std::move(priority))
+        priority(std::move(priority)),
+        flushInterval(std::move(flushInterval)),
+        flushSize(std::move(flushSize)),
+        deltaKeyFrameInterval(std::move(deltaKeyFrameInterval)),
+        compression(std::move(compression)),
+        compressionThreshold(std::move(compressionThreshold)),
+        highWaterMark(std::move(highWaterMark)),
+        highWaterMarkBytes(std::move(highWaterMarkBytes)),
+        overflowPolicy(std::move(overflowPolicy))
     {
     }
 
@@ -184,6 +289,77 @@ public:
      * the priority discard policy.
      */
     Ice::optional<int> priority;
+
+    /**
+     * The flushInterval configuration specifies how long (in milliseconds) the
+     * writer accumulates published samples before sending them to the readers
+     * with a single request. By default, samples are sent as soon as they are
+     * published.
+     */
+    Ice::optional<int> flushInterval;
+
+    /**
+     * The flushSize configuration specifies how many published samples the
+     * writer accumulates before sending them to the readers with a single
+     * request. It can be combined with flushInterval, the samples are sent
+     * when either limit is reached. By default, samples are sent as soon as
+     * they are published.
+     */
+    Ice::optional<int> flushSize;
+
+    /**
+     * The deltaKeyFrameInterval configuration enables the delta encoding of
+     * updates. If set to a value greater than 1, the writer sends the binary
+     * difference between the encoded value of an update and the encoded value
+     * of the previous sample when it's smaller than the value. A full update is
+     * sent every deltaKeyFrameInterval updates. Readers apply the delta to the
+     * value of the sample it was computed from and don't need any configuration.
+     * A delta is discarded by a reader which didn't receive this sample. Deltas
+     * are sent as full updates to readers with sample filters and delta encoding
+     * is disabled with the DropOldest overflow policy. By default, delta encoding
+     * is disabled.
+     */
+    Ice::optional<int> deltaKeyFrameInterval;
+
+    /**
+     * The compression configuration specifies how the writer compresses the
+     * sample values sent to readers. A compressed value is only sent if it's
+     * smaller than the value and if the reader supports the compression,
+     * readers decompressing a value larger than Ice.MessageSizeMax discard
+     * the sample. By default, values are not compressed.
+     */
+    Ice::optional<Compression> compression;
+
+    /**
+     * The compressionThreshold configuration specifies the minimum size in
+     * bytes of the sample values compressed by the writer. The default is
+     * 1024 bytes.
+     */
+    Ice::optional<int> compressionThreshold;
+
+    /**
+     * The highWaterMark configuration specifies how many sample requests can
+     * be queued for sending to a reader. When a reader reaches the high-water
+     * mark, the writer applies the overflow policy. By default, the number of
+     * queued requests isn't limited.
+     */
+    Ice::optional<int> highWaterMark;
+
+    /**
+     * The highWaterMarkBytes configuration specifies how many bytes of sample
+     * requests can be queued for sending to a reader. It can be combined with
+     * highWaterMark, the overflow policy is applied when either limit is
+     * reached. By default, the size of queued requests isn't limited.
+     */
+    Ice::optional<int> highWaterMarkBytes;
+
+    /**
+     * The overflowPolicy configuration specifies what the writer does when a
+     * reader reaches the high-water mark. The default is Block. If the policy
+     * is Conflate and no high-water mark is set, the samples are conflated as
+     * soon as a sample request is waiting to be sent to the reader.
+     */
+    Ice::optional<OverflowPolicy> overflowPolicy;
 };
 
 /**
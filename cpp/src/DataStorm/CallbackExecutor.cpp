@@ -2,55 +2,34 @@
 // Copyright (c) ZeroC, Inc. All rights reserved.
 //
 #include <DataStorm/CallbackExecutor.h>
+#include <DataStorm/DataElementI.h>
+#include <DataStorm/TraceUtil.h>
 
 using namespace std;
 using namespace DataStormI;
 
-CallbackExecutor::CallbackExecutor() : _flush(false), _destroyed(false)
+CallbackExecutor::CallbackExecutor(size_t threads, shared_ptr<TraceLevels> traceLevels) :
+    _traceLevels(move(traceLevels)),
+    _destroyed(false),
+    _ready(max<size_t>(threads, 1)),
+    _nextWorker(0),
+    _metrics()
 {
-    _thread = thread([this]
+    for(size_t i = 0; i < _ready.size(); ++i)
     {
-        std::vector<std::pair<std::shared_ptr<DataElementI>, std::function<void()>>> queue;
-        while(true)
-        {
-            unique_lock<mutex> lock(_mutex);
-            if(_destroyed)
-            {
-                break;
-            }
-            _cond.wait(lock, [this]{ return _flush || _destroyed; });
-            if(_flush)
-            {
-                _flush = false;
-                _queue.swap(queue);
-            }
-
-            lock.unlock();
-            for(const auto& p : queue)
-            {
-                try
-                {
-                    p.second();
-                }
-                catch(...)
-                {
-                    std::terminate();
-                }
-            }
-            queue.clear();
-        }
-    });
+        _threads.emplace_back([this, i] { runWorker(i); });
+    }
 }
 
 void
 CallbackExecutor::queue(const std::shared_ptr<DataElementI>& element, std::function<void()> cb, bool flush)
 {
     unique_lock<mutex> lock(_mutex);
-    _queue.emplace_back(element, cb);
+    _queue.emplace_back(element, Callback { move(cb), chrono::steady_clock::now() });
+    _metrics.maxQueueDepth = max(++_metrics.queueDepth, _metrics.maxQueueDepth);
     if(flush)
     {
-        _flush = true;
-        _cond.notify_one();
+        flushQueue();
     }
 }
 
@@ -58,11 +37,7 @@ void
 CallbackExecutor::flush()
 {
     unique_lock<mutex> lock(_mutex);
-    if(!_queue.empty())
-    {
-        _flush = true;
-        _cond.notify_one();
-    }
+    flushQueue();
 }
 
 void
@@ -70,7 +45,140 @@ CallbackExecutor::destroy()
 {
     unique_lock<mutex> lock(_mutex);
     _destroyed = true;
-    _cond.notify_one();
+    _cond.notify_all();
     lock.unlock();
-    _thread.join();
+    for(auto& thread : _threads)
+    {
+        thread.join();
+    }
+}
+
+CallbackExecutor::Metrics
+CallbackExecutor::getMetrics() const
+{
+    lock_guard<mutex> lock(_mutex);
+    return _metrics;
+}
+
+void
+CallbackExecutor::runWorker(size_t worker)
+{
+    unique_lock<mutex> lock(_mutex);
+    while(true)
+    {
+        shared_ptr<Strand> strand;
+        _cond.wait(lock, [&] { return _destroyed || (strand = nextStrand(worker)) != nullptr; });
+        if(_destroyed)
+        {
+            break;
+        }
+
+        //
+        // Run the callbacks queued for the element. The strand remains scheduled while its callbacks
+        // run to ensure no other worker runs callbacks for the same element.
+        //
+        deque<Callback> callbacks;
+        callbacks.swap(strand->callbacks);
+        strand->worker = worker;
+        lock.unlock();
+
+        chrono::microseconds totalLatency(0);
+        chrono::microseconds maxLatency(0);
+        for(const auto& cb : callbacks)
+        {
+            try
+            {
+                cb.callback();
+            }
+            catch(...)
+            {
+                std::terminate();
+            }
+            auto latency = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - cb.queueTime);
+            totalLatency += latency;
+            maxLatency = max(latency, maxLatency);
+        }
+
+        lock.lock();
+        _metrics.queueDepth -= callbacks.size();
+        _metrics.callbacks += callbacks.size();
+        _metrics.totalLatency += totalLatency;
+        _metrics.maxLatency = max(maxLatency, _metrics.maxLatency);
+        if(_traceLevels && _traceLevels->data > 2)
+        {
+            Trace out(_traceLevels, _traceLevels->dataCat);
+            out << strand->element << ": ran " << callbacks.size() << " callback(s) (max latency = ";
+            out << maxLatency.count() << "us, queue depth = " << _metrics.queueDepth << ")";
+        }
+
+        if(strand->callbacks.empty())
+        {
+            strand->scheduled = false;
+            _strands.erase(strand->element.get());
+        }
+        else
+        {
+            // Callbacks were queued for the element while running the callbacks, reschedule the strand.
+            _ready[worker].push_back(strand);
+        }
+    }
+}
+
+void
+CallbackExecutor::flushQueue()
+{
+    // Called with the mutex locked, move the queued callbacks to the element strands.
+    for(auto& p : _queue)
+    {
+        auto& strand = _strands[p.first.get()];
+        if(!strand)
+        {
+            strand = make_shared<Strand>(p.first, _nextWorker++ % _ready.size());
+        }
+        strand->callbacks.push_back(move(p.second));
+        if(!strand->scheduled)
+        {
+            schedule(strand);
+        }
+    }
+    _queue.clear();
+}
+
+void
+CallbackExecutor::schedule(const shared_ptr<Strand>& strand)
+{
+    //
+    // The strand is queued with the worker which last ran its callbacks, if this worker is busy the
+    // strand is stolen by an idle worker.
+    //
+    strand->scheduled = true;
+    _ready[strand->worker].push_back(strand);
+    _cond.notify_one();
+}
+
+shared_ptr<CallbackExecutor::Strand>
+CallbackExecutor::nextStrand(size_t worker)
+{
+    //
+    // Called with the mutex locked, returns the oldest strand queued with this worker or steal the
+    // newest strand queued with another worker.
+    //
+    shared_ptr<Strand> strand;
+    if(!_ready[worker].empty())
+    {
+        strand = move(_ready[worker].front());
+        _ready[worker].pop_front();
+        return strand;
+    }
+    for(size_t i = 1; i < _ready.size(); ++i)
+    {
+        auto& ready = _ready[(worker + i) % _ready.size()];
+        if(!ready.empty())
+        {
+            strand = move(ready.back());
+            ready.pop_back();
+            return strand;
+        }
+    }
+    return strand;
 }
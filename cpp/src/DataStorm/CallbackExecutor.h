@@ -3,6 +3,9 @@
 //
 #pragma once
 
+#include <chrono>
+#include <deque>
+#include <map>
 #include <vector>
 #include <memory>
 #include <mutex>
@@ -14,25 +17,75 @@ namespace DataStormI
 {
 
 class DataElementI;
+class TraceLevels;
 
+//
+// The callback executor runs the user callbacks with a pool of threads. The callbacks of a given
+// data element are run in order by a single thread at a time (the element strand) while the
+// callbacks of different elements can run in parallel. Queued callbacks are runnable once the
+// executor is flushed.
+//
 class CallbackExecutor
 {
 public:
 
-    CallbackExecutor();
+    struct Metrics
+    {
+        // The number of callbacks queued and not run yet and the maximum number of queued callbacks.
+        size_t queueDepth;
+        size_t maxQueueDepth;
+
+        // The number of callbacks run and their latency, from the time they are queued to their completion.
+        unsigned long long int callbacks;
+        std::chrono::microseconds totalLatency;
+        std::chrono::microseconds maxLatency;
+    };
+
+    CallbackExecutor(size_t = 1, std::shared_ptr<TraceLevels> = nullptr);
 
     void queue(const std::shared_ptr<DataElementI>&, std::function<void()>, bool = false);
     void flush();
     void destroy();
 
+    Metrics getMetrics() const;
+
 private:
 
-    std::mutex _mutex;
-    std::thread _thread;
+    struct Callback
+    {
+        std::function<void()> callback;
+        std::chrono::steady_clock::time_point queueTime;
+    };
+
+    struct Strand
+    {
+        Strand(std::shared_ptr<DataElementI> element, size_t worker) :
+            element(std::move(element)), scheduled(false), worker(worker)
+        {
+        }
+
+        const std::shared_ptr<DataElementI> element;
+        std::deque<Callback> callbacks;
+        bool scheduled;
+        size_t worker;
+    };
+
+    void runWorker(size_t);
+    void flushQueue();
+    void schedule(const std::shared_ptr<Strand>&);
+    std::shared_ptr<Strand> nextStrand(size_t);
+
+    const std::shared_ptr<TraceLevels> _traceLevels;
+
+    mutable std::mutex _mutex;
+    std::vector<std::thread> _threads;
     std::condition_variable _cond;
-    bool _flush;
     bool _destroyed;
-    std::vector<std::pair<std::shared_ptr<DataElementI>, std::function<void()>>> _queue;
+    std::vector<std::pair<std::shared_ptr<DataElementI>, Callback>> _queue;
+    std::map<DataElementI*, std::shared_ptr<Strand>> _strands;
+    std::vector<std::deque<std::shared_ptr<Strand>>> _ready;
+    size_t _nextWorker;
+    Metrics _metrics;
 };
 
 }
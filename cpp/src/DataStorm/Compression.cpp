@@ -0,0 +1,117 @@
+//
+// Copyright (c) ZeroC, Inc. All rights reserved.
+//
+#include <DataStorm/Compression.h>
+
+#include <Ice/LocalException.h>
+
+#ifdef DATASTORM_HAS_ZLIB
+#   include <zlib.h>
+#endif
+
+using namespace std;
+using namespace DataStormI;
+
+namespace
+{
+
+//
+// A compressed value starts with the compression byte. A zlib compressed value is followed by the size of the
+// uncompressed value, encoded as a 32-bit little endian integer, and by the zlib stream.
+//
+const size_t compressionSize = 1;
+#ifdef DATASTORM_HAS_ZLIB
+const size_t headerSize = compressionSize + 4;
+#endif
+
+}
+
+const string DataStormI::compressionContext = "ds-compression";
+
+bool
+DataStormI::isCompressionSupported(DataStorm::Compression compression)
+{
+#ifdef DATASTORM_HAS_ZLIB
+    return compression == DataStorm::Compression::Zlib;
+#else
+    (void)compression;
+    return false;
+#endif
+}
+
+vector<unsigned char>
+DataStormI::compressValue(DataStorm::Compression compression, size_t threshold, const vector<unsigned char>& value)
+{
+#ifdef DATASTORM_HAS_ZLIB
+    if(compression == DataStorm::Compression::Zlib && value.size() >= threshold && value.size() > headerSize &&
+       value.size() <= 0xFFFFFFFF)
+    {
+        uLongf size = compressBound(static_cast<uLong>(value.size()));
+        vector<unsigned char> compressed(headerSize + size);
+        if(compress2(&compressed[headerSize], &size, &value[0], static_cast<uLong>(value.size()), Z_BEST_SPEED) == Z_OK &&
+           headerSize + size < value.size() + compressionSize)
+        {
+            compressed[0] = static_cast<unsigned char>(compression);
+            for(size_t i = 0; i < headerSize - compressionSize; ++i)
+            {
+                compressed[compressionSize + i] = static_cast<unsigned char>(value.size() >> (i * 8));
+            }
+            compressed.resize(headerSize + size);
+            return compressed;
+        }
+    }
+#else
+    (void)compression;
+    (void)threshold;
+#endif
+    vector<unsigned char> uncompressed;
+    uncompressed.reserve(compressionSize + value.size());
+    uncompressed.push_back(static_cast<unsigned char>(DataStorm::Compression::None));
+    uncompressed.insert(uncompressed.end(), value.begin(), value.end());
+    return uncompressed;
+}
+
+vector<unsigned char>
+DataStormI::decompressValue(const vector<unsigned char>& value, size_t maxSize)
+{
+    if(value.empty())
+    {
+        throw Ice::MarshalException(__FILE__, __LINE__, "missing sample value compression");
+    }
+
+    auto compression = static_cast<DataStorm::Compression>(value[0]);
+    if(compression == DataStorm::Compression::None)
+    {
+        return vector<unsigned char>(value.begin() + compressionSize, value.end());
+    }
+#ifdef DATASTORM_HAS_ZLIB
+    else if(compression == DataStorm::Compression::Zlib && value.size() > headerSize)
+    {
+        //
+        // The size is provided by the peer, check it before allocating the decompressed value.
+        //
+        uLongf size = 0;
+        for(size_t i = 0; i < headerSize - compressionSize; ++i)
+        {
+            size |= static_cast<uLongf>(value[compressionSize + i]) << (i * 8);
+        }
+        if(maxSize > 0 && size > maxSize)
+        {
+            throw Ice::MarshalException(__FILE__, __LINE__, "decompressed sample value size `" + to_string(size) +
+                                        "' exceeds the maximum size `" + to_string(maxSize) + "'");
+        }
+
+        vector<unsigned char> decompressed(size);
+        if(size > 0 &&
+           uncompress(&decompressed[0], &size, &value[headerSize], static_cast<uLong>(value.size() - headerSize)) == Z_OK &&
+           size == decompressed.size())
+        {
+            return decompressed;
+        }
+    }
+#else
+    (void)maxSize;
+#endif
+    throw Ice::MarshalException(__FILE__, __LINE__, "unable to decompress sample value with compression " +
+                                to_string(static_cast<int>(compression)));
+}
@@ -0,0 +1,39 @@
+//
+// Copyright (c) ZeroC, Inc. All rights reserved.
+//
+#pragma once
+
+#include <DataStorm/Types.h>
+
+#include <string>
+#include <vector>
+
+namespace DataStormI
+{
+
+//
+// The sample requests sent by a writer with compression enabled to readers which support the writer compression
+// carry this request context entry. The value of each sample of these requests is prefixed with a byte which
+// specifies the compression of the value, 0 if the value isn't compressed.
+//
+extern const std::string compressionContext;
+
+//
+// Returns true if the given compression is supported by this build.
+//
+bool isCompressionSupported(DataStorm::Compression);
+
+//
+// Returns the compressed form of the given encoded value. The value is only compressed with the given compression
+// if it's at least the given size and if the compressed value is smaller than the value, it's otherwise prefixed
+// with the uncompressed value byte.
+//
+std::vector<unsigned char> compressValue(DataStorm::Compression, size_t, const std::vector<unsigned char>&);
+
+//
+// Returns the encoded value of the given compressed form, raises Ice::MarshalException if the value can't be
+// decompressed or if the decompressed value is larger than the given maximum size (0 for no maximum).
+//
+std::vector<unsigned char> decompressValue(const std::vector<unsigned char>&, size_t);
+
+}
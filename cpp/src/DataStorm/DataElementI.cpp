@@ -7,6 +7,13 @@
 #include <DataStorm/Instance.h>
 #include <DataStorm/TraceUtil.h>
 #include <DataStorm/CallbackExecutor.h>
+#include <DataStorm/Timer.h>
+#include <DataStorm/Delta.h>
+#include <DataStorm/Compression.h>
+
+#include <Ice/LoggerUtil.h>
+
+#include <set>
 
 using namespace std;
 using namespace DataStormI;
@@ -15,6 +22,13 @@ using namespace DataStormContract;
 namespace
 {
 
+//
+// The maximum number of consecutive partial updates lazily applied by a reader. A lazily applied
+// partial update keeps a reference to the previous sample, once this number is reached the partial
+// update is applied on receipt to bound the number of samples kept alive.
+//
+const size_t maxLazyUpdates = 32;
+
 DataSample
 toSample(const shared_ptr<Sample>& sample, const shared_ptr<Ice::Communicator>& communicator, bool marshalKey)
 {
@@ -28,17 +42,106 @@ toSample(const shared_ptr<Sample>& sample, const shared_ptr<Ice::Communicator>&
 }
 
 void
-cleanOldSamples(deque<shared_ptr<Sample>>& samples,
-                const chrono::time_point<chrono::system_clock>& now,
-                int lifetime)
+cleanOldSamples(SampleHistory& samples, const chrono::time_point<chrono::system_clock>& now, int lifetime)
+{
+    samples.expire(now - chrono::milliseconds(lifetime));
+}
+
+chrono::time_point<chrono::system_clock>
+expireHistory(SampleHistory& samples,
+              const chrono::time_point<chrono::system_clock>& now,
+              const Ice::optional<int>& lifetime)
+{
+    // Expire the old samples and return the expiry time of the oldest sample left.
+    if(!lifetime || *lifetime <= 0)
+    {
+        return chrono::time_point<chrono::system_clock>::max();
+    }
+    cleanOldSamples(samples, now, *lifetime);
+    if(samples.empty())
+    {
+        return chrono::time_point<chrono::system_clock>::max();
+    }
+    return samples.getOldestTimestamp() + chrono::milliseconds(*lifetime);
+}
+
+DataStorm::Compression
+getCompression(const DataStorm::WriterConfig& config, const shared_ptr<Ice::Communicator>& communicator)
+{
+    if(!config.compression || *config.compression == DataStorm::Compression::None)
+    {
+        return DataStorm::Compression::None;
+    }
+    else if(!isCompressionSupported(*config.compression))
+    {
+        Ice::Warning out(communicator->getLogger());
+        out << "sample value compression `" << static_cast<int>(*config.compression) << "' is not supported";
+        return DataStorm::Compression::None;
+    }
+    return *config.compression;
+}
+
+int
+getDeltaKeyFrameInterval(const DataStorm::WriterConfig& config)
 {
-    chrono::time_point<chrono::system_clock> staleTime = now - chrono::milliseconds(lifetime);
-    auto p = stable_partition(samples.begin(), samples.end(),
-                              [&](const shared_ptr<Sample>& s) { return s->timestamp < staleTime; });
-    if(p != samples.begin())
+    //
+    // Delta encoding is disabled with the drop oldest overflow policy, the listeners wouldn't get the samples
+    // the deltas are computed from if their sample requests are dropped.
+    //
+    if(!config.deltaKeyFrameInterval ||
+       (config.overflowPolicy && *config.overflowPolicy == DataStorm::OverflowPolicy::DropOldest &&
+        ((config.highWaterMark && *config.highWaterMark > 0) ||
+         (config.highWaterMarkBytes && *config.highWaterMarkBytes > 0))))
     {
-        samples.erase(samples.begin(), p);
+        return 0;
     }
+    return *config.deltaKeyFrameInterval;
+}
+
+FlowControl::Request
+createSamplesRequest(const shared_ptr<SubscriberSessionPrx>& subscriber,
+                     long long int topicId,
+                     long long int elementId,
+                     const shared_ptr<DataSampleSeq>& samples,
+                     const Ice::Context& ctx,
+                     bool batches)
+{
+    return [subscriber, topicId, elementId, samples, ctx, batches](function<void()> completed)
+    {
+        auto exception = [completed](exception_ptr) { completed(); };
+        auto sent = [completed](bool) { completed(); };
+        if(batches)
+        {
+            subscriber->ssAsync(topicId, elementId, *samples, [] {}, exception, sent, ctx);
+            return;
+        }
+
+        //
+        // Listeners which don't support the ss operation get an s request per sample. The requests are sent
+        // in order over the listener connection, the request is completed once the last one is sent.
+        //
+        for(auto p = samples->begin(); p != samples->end(); ++p)
+        {
+            if(p + 1 == samples->end())
+            {
+                subscriber->sAsync(topicId, elementId, *p, [] {}, exception, sent, ctx);
+            }
+            else
+            {
+                subscriber->sAsync(topicId, elementId, *p, [] {}, nullptr, nullptr, ctx);
+            }
+        }
+        if(samples->empty())
+        {
+            completed();
+        }
+    };
+}
+
+size_t
+getHistoryCapacity(const DataStorm::Config& config)
+{
+    return config.sampleCount && *config.sampleCount > 0 ? static_cast<size_t>(*config.sampleCount) : 0;
 }
 
 }
@@ -50,6 +153,7 @@ DataElementI::DataElementI(TopicI* parent, const string& name, long long int id,
     _config(make_shared<ElementConfig>()),
     _executor(parent->getInstance()->getCallbackExecutor()),
     _listenerCount(0),
+    _compression(DataStorm::Compression::None),
     _parent(parent->shared_from_this()),
     _waiters(0),
     _notified(0),
@@ -113,6 +217,7 @@ DataElementI::attach(long long int topicId,
     }
     string facet = data.config->facet ? *data.config->facet : string();
     int priority = data.config->priority ? *data.config->priority : 0;
+    int minSampleInterval = data.config->minSampleInterval ? max(*data.config->minSampleInterval, 0) : 0;
     string name;
     if(data.config->name)
     {
@@ -124,8 +229,12 @@ DataElementI::attach(long long int topicId,
         os << session->getId() << '-' << topicId << '-' << data.id;
         name = os.str();
     }
-    if((id > 0 && attachKey(topicId, data.id, key, sampleFilter, session, prx, facet, id, name, priority)) ||
-       (id < 0 && attachFilter(topicId, data.id, key, sampleFilter, session, prx, facet, id, filter, name, priority)))
+    if((id > 0 &&
+        attachKey(topicId, data.id, key, sampleFilter, session, prx, facet, id, name, priority, minSampleInterval,
+                  *data.config)) ||
+       (id < 0 &&
+        attachFilter(topicId, data.id, key, sampleFilter, session, prx, facet, id, filter, name, priority,
+                     minSampleInterval, *data.config)))
     {
         auto q = data.lastIds.find(_id);
         long long lastId = q != data.lastIds.end() ? q->second : 0;
@@ -154,6 +263,7 @@ DataElementI::attach(long long int topicId,
     }
     string facet = data.config->facet ? *data.config->facet : string();
     int priority = data.config->priority ? *data.config->priority : 0;
+    int minSampleInterval = data.config->minSampleInterval ? max(*data.config->minSampleInterval, 0) : 0;
     string name;
     if(data.config->name)
     {
@@ -165,8 +275,12 @@ DataElementI::attach(long long int topicId,
         os << session->getId() << '-' << topicId << '-' << data.id;
         name = os.str();
     }
-    if((id > 0 && attachKey(topicId, data.id, key, sampleFilter, session, prx, facet, id, name, priority)) ||
-       (id < 0 && attachFilter(topicId, data.id, key, sampleFilter, session, prx, facet, id, filter, name, priority)))
+    if((id > 0 &&
+        attachKey(topicId, data.id, key, sampleFilter, session, prx, facet, id, name, priority, minSampleInterval,
+                  *data.config)) ||
+       (id < 0 &&
+        attachFilter(topicId, data.id, key, sampleFilter, session, prx, facet, id, filter, name, priority,
+                     minSampleInterval, *data.config)))
     {
         auto q = data.lastIds.find(_id);
         long long lastId = q != data.lastIds.end() ? q->second : 0;
@@ -192,17 +306,29 @@ DataElementI::attachKey(long long int topicId,
                         const string& facet,
                         long long int keyId,
                         const string& name,
-                        int priority)
+                        int priority,
+                        int minSampleInterval,
+                        const ElementConfig& config)
 {
     // No locking necessary, called by the session with the mutex locked
     auto p = _listeners.find({ session, facet });
     if(p == _listeners.end())
     {
-        p = _listeners.emplace(ListenerKey { session, facet }, Listener(prx, facet)).first;
+        p = _listeners.emplace(ListenerKey { session, facet }, createListener(prx, facet, config)).first;
+        if(_flowControl)
+        {
+            p->second.flowControl = _flowControl->createListener(session->getId(), p->second.proxy,
+                                                                 p->second.compressed);
+        }
+    }
+    if(minSampleInterval > 0 && !p->second.throttle)
+    {
+        p->second.throttle = make_shared<Throttle>(p->first);
     }
 
     bool added = false;
-    auto subscriber = p->second.addOrGet(topicId, elementId, keyId, nullptr, sampleFilter, name, priority, added);
+    auto subscriber = p->second.addOrGet(topicId, elementId, keyId, nullptr, sampleFilter, name, priority,
+                                         minSampleInterval, added);
     if(_onConnectedElements && added)
     {
         _executor->queue(shared_from_this(), [=]
@@ -216,6 +342,7 @@ DataElementI::attachKey(long long int topicId,
         {
             subscriber->keys.insert(key);
         }
+        addKeyListener(key, p->second, subscriber);
         if(_traceLevels->data > 1)
         {
             Trace out(_traceLevels, _traceLevels->dataCat);
@@ -236,6 +363,20 @@ DataElementI::attachKey(long long int topicId,
     return false;
 }
 
+DataElementI::Listener
+DataElementI::createListener(const shared_ptr<SessionPrx>& prx, const string& facet, const ElementConfig& config) const
+{
+    //
+    // Readers advertise the compressions and the batch requests supported by their node with the element
+    // configuration. All the subscribers of a listener are on the same node.
+    //
+    bool compressed = _compression != DataStorm::Compression::None && config.compressions &&
+        find(config.compressions->begin(), config.compressions->end(), static_cast<Ice::Byte>(_compression)) !=
+            config.compressions->end();
+    bool batches = config.sampleBatches && *config.sampleBatches;
+    return Listener(prx, facet, compressed, batches);
+}
+
 void
 DataElementI::detachKey(long long int topicId,
                         long long int elementId,
@@ -258,6 +399,7 @@ DataElementI::detachKey(long long int topicId,
         {
             subscriber->keys.erase(key);
         }
+        removeKeyListener(key, p->second, subscriber);
         if(subscriber->keys.empty())
         {
             if(_onConnectedElements)
@@ -304,17 +446,29 @@ DataElementI::attachFilter(long long int topicId,
                            long long int filterId,
                            const shared_ptr<Filter>& filter,
                            const string& name,
-                           int priority)
+                           int priority,
+                           int minSampleInterval,
+                           const ElementConfig& config)
 {
     // No locking necessary, called by the session with the mutex locked
     auto p = _listeners.find({ session, facet });
     if(p == _listeners.end())
     {
-        p = _listeners.emplace(ListenerKey { session, facet }, Listener(prx, facet)).first;
+        p = _listeners.emplace(ListenerKey { session, facet }, createListener(prx, facet, config)).first;
+        if(_flowControl)
+        {
+            p->second.flowControl = _flowControl->createListener(session->getId(), p->second.proxy,
+                                                                 p->second.compressed);
+        }
+    }
+    if(minSampleInterval > 0 && !p->second.throttle)
+    {
+        p->second.throttle = make_shared<Throttle>(p->first);
     }
 
     bool added = false;
-    auto subscriber = p->second.addOrGet(topicId, -elementId, filterId, filter, sampleFilter, name, priority, added);
+    auto subscriber = p->second.addOrGet(topicId, -elementId, filterId, filter, sampleFilter, name, priority,
+                                         minSampleInterval, added);
     if(_onConnectedElements && added)
     {
         _executor->queue(shared_from_this(), [=]
@@ -328,6 +482,7 @@ DataElementI::attachFilter(long long int topicId,
         {
             subscriber->keys.insert(key);
         }
+        addKeyListener(key, p->second, subscriber);
         if(_traceLevels->data > 1)
         {
             Trace out(_traceLevels, _traceLevels->dataCat);
@@ -370,6 +525,7 @@ DataElementI::detachFilter(long long int topicId,
         {
             subscriber->keys.erase(key);
         }
+        removeKeyListener(key, p->second, subscriber);
         if(subscriber->keys.empty())
         {
             if(_onConnectedElements)
@@ -522,7 +678,7 @@ DataElementI::waitForListeners(int count) const
             --_waiters;
             return;
         }
-        _parent->_cond.wait(lock);
+        _cond.wait(lock);
         ++_notified;
     }
 }
@@ -534,6 +690,13 @@ DataElementI::hasListeners() const
     return _listenerCount > 0;
 }
 
+void
+DataElementI::shutdown() const
+{
+    // Called with the topic mutex locked, wake up the waiting threads to check for the node shutdown.
+    _cond.notify_all();
+}
+
 shared_ptr<Ice::Communicator>
 DataElementI::getCommunicator() const
 {
@@ -583,14 +746,112 @@ DataElementI::removeConnectedKey(const shared_ptr<Key>& key, const shared_ptr<Su
     return false;
 }
 
+void
+DataElementI::addKeyListener(const shared_ptr<Key>& key,
+                             const Listener& listener,
+                             const shared_ptr<Subscriber>& subscriber)
+{
+    _keyListeners[key][&listener].push_back(subscriber);
+}
+
+void
+DataElementI::removeKeyListener(const shared_ptr<Key>& key,
+                                const Listener& listener,
+                                const shared_ptr<Subscriber>& subscriber)
+{
+    auto p = _keyListeners.find(key);
+    if(p == _keyListeners.end())
+    {
+        return;
+    }
+    auto q = p->second.find(&listener);
+    if(q == p->second.end())
+    {
+        return;
+    }
+    auto r = find(q->second.begin(), q->second.end(), subscriber);
+    if(r != q->second.end())
+    {
+        q->second.erase(r);
+    }
+    if(q->second.empty())
+    {
+        p->second.erase(q);
+        if(p->second.empty())
+        {
+            _keyListeners.erase(p);
+        }
+    }
+}
+
+void
+DataElementI::getKeyListeners(const shared_ptr<Sample>& sample,
+                              FilterMatches& filterMatches,
+                              vector<const Listener*>& listeners) const
+{
+    auto match = [&](const shared_ptr<Key>& key)
+    {
+        auto p = _keyListeners.find(key);
+        if(p == _keyListeners.end())
+        {
+            return;
+        }
+        for(const auto& l : p->second)
+        {
+            for(const auto& s : l.second)
+            {
+                if((key || s->keys.empty()) &&
+                   (!s->filter || filterMatches.match(s->filter, sample->key)) &&
+                   (!s->sampleFilter || filterMatches.match(s->sampleFilter, sample)))
+                {
+                    listeners.push_back(l.first);
+                    break;
+                }
+            }
+        }
+    };
+
+    listeners.clear();
+    match(sample->key);
+    if(sample->key)
+    {
+        match(nullptr);
+        if(listeners.size() > 1)
+        {
+            sort(listeners.begin(), listeners.end());
+            listeners.erase(unique(listeners.begin(), listeners.end()), listeners.end());
+        }
+    }
+}
+
+chrono::time_point<chrono::system_clock>
+DataElementI::expireSamples(const chrono::time_point<chrono::system_clock>&)
+{
+    return chrono::time_point<chrono::system_clock>::max();
+}
+
+void
+DataElementI::scheduleExpiry(const shared_ptr<Sample>& sample)
+{
+    //
+    // Called with the topic mutex locked when a sample is added to the sample history. The samples
+    // are expired by the topic, this only ensures the topic expiry is scheduled before the sample
+    // expires.
+    //
+    if(_config->sampleLifetime && *_config->sampleLifetime > 0)
+    {
+        _parent->scheduleExpiry(sample->timestamp + chrono::milliseconds(*_config->sampleLifetime));
+    }
+}
+
 void
 DataElementI::notifyListenerWaiters(unique_lock<mutex>& lock) const
 {
     if(_waiters > 0)
     {
         _notified = 0;
-        _parent->_cond.notify_all();
-        _parent->_cond.wait(lock, [&]() { return _notified < _waiters; }); // Wait until all the waiters are notified.
+        _cond.notify_all();
+        _cond.wait(lock, [&]() { return _notified < _waiters; }); // Wait until all the waiters are notified.
     }
 }
 
@@ -601,6 +862,7 @@ DataElementI::disconnect()
     {
         unique_lock<mutex> lock(_parent->_mutex);
         listeners.swap(_listeners);
+        _keyListeners.clear();
         _parent->decListenerCount(_listenerCount);
         _listenerCount = 0;
         notifyListenerWaiters(lock);
@@ -625,10 +887,11 @@ DataElementI::disconnect()
 void
 DataElementI::forward(const Ice::ByteSeq& inEncaps, const Ice::Current& current) const
 {
+    FilterMatches filterMatches;
     for(const auto& listener : _listeners)
     {
         // If there's at least one subscriber interested in the update
-        if(!_sample || listener.second.matchOne(_sample, false))
+        if(!_sample || listener.second.matchOne(_sample, false, filterMatches))
         {
             listener.second.proxy->ice_invokeAsync(current.operation, current.mode, inEncaps, current.ctx);
         }
@@ -643,8 +906,19 @@ DataReaderI::DataReaderI(TopicReaderI* topic,
                          const DataStorm::ReaderConfig& config) :
     DataElementI(topic, name, id, config),
     _parent(topic),
-    _discardPolicy(config.discardPolicy ? *config.discardPolicy : DataStorm::DiscardPolicy::None)
+    _samples(getHistoryCapacity(config)),
+    _discardPolicy(config.discardPolicy ? *config.discardPolicy : DataStorm::DiscardPolicy::None),
+    _lazyDecode(config.lazyDecode && *config.lazyDecode),
+    _lazyUpdates(0),
+    _lastValueCache(config.lastValueCache && *config.lastValueCache),
+    _sampleBatchQueued(false)
 {
+    _config->minSampleInterval = config.minSampleInterval;
+    _config->sampleBatches = true;
+    if(isCompressionSupported(DataStorm::Compression::Zlib))
+    {
+        _config->compressions = Ice::ByteSeq { static_cast<Ice::Byte>(DataStorm::Compression::Zlib) };
+    }
     if(!sampleFilterName.empty())
     {
         _config->sampleFilter = FilterInfo { sampleFilterName, move(sampleFilterCriteria) };
@@ -662,16 +936,23 @@ vector<shared_ptr<Sample>>
 DataReaderI::getAllUnread()
 {
     lock_guard<mutex> lock(_parent->_mutex);
-    vector<shared_ptr<Sample>> unread(_samples.begin(), _samples.end());
-    _samples.clear();
+    vector<shared_ptr<Sample>> unread;
+    _samples.take(_samples.size(), unread);
     return unread;
 }
 
+void
+DataReaderI::takeUnread(size_t count, vector<shared_ptr<Sample>>& unread)
+{
+    lock_guard<mutex> lock(_parent->_mutex);
+    _samples.take(count, unread);
+}
+
 void
 DataReaderI::waitForUnread(unsigned int count) const
 {
     unique_lock<mutex> lock(_parent->_mutex);
-    _parent->_cond.wait(lock, [&]() { _parent->getInstance()->checkShutdown(); return _samples.size() >= count; });
+    _cond.wait(lock, [&]() { _parent->getInstance()->checkShutdown(); return _samples.size() >= count; });
 }
 
 bool
@@ -685,12 +966,33 @@ shared_ptr<Sample>
 DataReaderI::getNextUnread()
 {
     unique_lock<mutex> lock(_parent->_mutex);
-    _parent->_cond.wait(lock, [&]() { _parent->getInstance()->checkShutdown(); return !_samples.empty(); });
+    _cond.wait(lock, [&]() { _parent->getInstance()->checkShutdown(); return !_samples.empty(); });
     shared_ptr<Sample> sample = _samples.front();
     _samples.pop_front();
     return sample;
 }
 
+shared_ptr<Sample>
+DataReaderI::getLast(const shared_ptr<Key>& key) const
+{
+    lock_guard<mutex> lock(_parent->_mutex);
+    auto p = _lastValues.find(key);
+    return p != _lastValues.end() ? p->second : nullptr;
+}
+
+vector<shared_ptr<Sample>>
+DataReaderI::getAllLast() const
+{
+    lock_guard<mutex> lock(_parent->_mutex);
+    vector<shared_ptr<Sample>> samples;
+    samples.reserve(_lastValues.size());
+    for(const auto& p : _lastValues)
+    {
+        samples.push_back(p.second);
+    }
+    return samples;
+}
+
 void
 DataReaderI::initSamples(const vector<shared_ptr<Sample>>& samples,
                          long long int topic,
@@ -723,20 +1025,12 @@ DataReaderI::initSamples(const vector<shared_ptr<Sample>>& samples,
         {
             continue;
         }
-        assert(sample->key);
-        valid.push_back(sample);
-
-        if(!sample->hasValue())
+        else if(!sample->hasValue() && !decodeSample(sample, previous))
         {
-            if(sample->event == DataStorm::SampleEvent::PartialUpdate)
-            {
-                _parent->getUpdater(sample->tag)(previous, sample, _parent->getInstance()->getCommunicator());
-            }
-            else
-            {
-                sample->decode(_parent->getInstance()->getCommunicator());
-            }
+            continue;
         }
+        assert(sample->key);
+        valid.push_back(sample);
         previous = sample;
     }
 
@@ -757,15 +1051,25 @@ DataReaderI::initSamples(const vector<shared_ptr<Sample>>& samples,
         });
     }
 
+    if(_onSampleBatch && !valid.empty())
+    {
+        _sampleBatch.insert(_sampleBatch.end(), valid.begin(), valid.end());
+        queueSampleBatch(false);
+    }
+
     if(valid.empty())
     {
         return;
     }
     _lastSendTime = valid.back()->timestamp;
+    _last = valid.back();
 
-    if(_config->sampleLifetime && *_config->sampleLifetime > 0)
+    if(_lastValueCache)
     {
-        cleanOldSamples(_samples, now, *_config->sampleLifetime);
+        for(const auto& s : valid)
+        {
+            cacheLastValue(s);
+        }
     }
 
     if(_config->sampleCount)
@@ -811,8 +1115,11 @@ DataReaderI::initSamples(const vector<shared_ptr<Sample>>& samples,
         }
     }
     assert(!_samples.empty());
-    _last = _samples.back();
-    _parent->_cond.notify_all();
+    for(const auto& s : valid)
+    {
+        scheduleExpiry(s);
+    }
+    _cond.notify_all();
 }
 
 void
@@ -859,27 +1166,27 @@ DataReaderI::queue(const shared_ptr<Sample>& sample,
         return;
     }
 
-    if(!sample->hasValue())
+    if(!sample->hasValue() && !decodeSample(sample, _last))
     {
-        if(sample->event == DataStorm::SampleEvent::PartialUpdate)
-        {
-            _parent->getUpdater(sample->tag)(_last, sample, _parent->getInstance()->getCommunicator());
-        }
-        else
-        {
-            sample->decode(_parent->getInstance()->getCommunicator());
-        }
+        return;
     }
     _lastSendTime = sample->timestamp;
+    _last = sample;
+
+    if(_lastValueCache)
+    {
+        cacheLastValue(sample);
+    }
 
     if(_onSamples)
     {
         _executor->queue(shared_from_this(), [this, sample] { _onSamples(sample); });
     }
 
-    if(_config->sampleLifetime && *_config->sampleLifetime > 0)
+    if(_onSampleBatch)
     {
-        cleanOldSamples(_samples, now, *_config->sampleLifetime);
+        _sampleBatch.push_back(sample);
+        queueSampleBatch(false);
     }
 
     if(_config->sampleCount)
@@ -913,8 +1220,8 @@ DataReaderI::queue(const shared_ptr<Sample>& sample,
         _samples.clear();
     }
     _samples.push_back(sample);
-    _last = sample;
-    _parent->_cond.notify_all();
+    scheduleExpiry(sample);
+    _cond.notify_all();
 }
 
 void
@@ -930,6 +1237,73 @@ DataReaderI::onSamples(function<void(const vector<shared_ptr<Sample>>&)> init,
     }
 }
 
+void
+DataReaderI::onSampleBatch(function<void(const vector<shared_ptr<Sample>>&)> batch)
+{
+    unique_lock<mutex> lock(_parent->_mutex);
+    _onSampleBatch = move(batch);
+    _sampleBatch.clear();
+    if(_onSampleBatch && !_samples.empty())
+    {
+        _sampleBatch.assign(_samples.begin(), _samples.end());
+        queueSampleBatch(true);
+    }
+}
+
+chrono::time_point<chrono::system_clock>
+DataReaderI::expireSamples(const chrono::time_point<chrono::system_clock>& now)
+{
+    return expireHistory(_samples, now, _config->sampleLifetime);
+}
+
+void
+DataReaderI::cacheLastValue(const shared_ptr<Sample>& sample)
+{
+    // Called with the topic mutex locked, the last value of a key is removed with the key.
+    if(sample->event == DataStorm::SampleEvent::Remove)
+    {
+        _lastValues.erase(sample->key);
+    }
+    else
+    {
+        _lastValues[sample->key] = sample;
+    }
+}
+
+void
+DataReaderI::queueSampleBatch(bool flush)
+{
+    //
+    // Called with the topic mutex locked. A single callback is queued with the executor for the
+    // samples received until it runs, it takes the samples batched so far and calls the batch
+    // callback with these samples.
+    //
+    if(_sampleBatchQueued)
+    {
+        if(flush)
+        {
+            _executor->flush();
+        }
+        return;
+    }
+    _sampleBatchQueued = true;
+    _executor->queue(shared_from_this(), [this]
+    {
+        vector<shared_ptr<Sample>> samples;
+        function<void(const vector<shared_ptr<Sample>>&)> batch;
+        {
+            lock_guard<mutex> lock(_parent->_mutex);
+            samples.swap(_sampleBatch);
+            batch = _onSampleBatch;
+            _sampleBatchQueued = false;
+        }
+        if(batch && !samples.empty())
+        {
+            batch(samples);
+        }
+    }, flush);
+}
+
 bool
 DataReaderI::addConnectedKey(const shared_ptr<Key>& key, const shared_ptr<Subscriber>& subscriber)
 {
@@ -952,14 +1326,76 @@ DataReaderI::addConnectedKey(const shared_ptr<Key>& key, const shared_ptr<Subscr
     }
 }
 
+bool
+DataReaderI::decodeSample(const shared_ptr<Sample>& sample, const shared_ptr<Sample>& previous)
+{
+    // Called with the topic mutex locked
+    auto communicator = _parent->getInstance()->getCommunicator();
+    if(sample->tag == getDeltaTag())
+    {
+        //
+        // Delta samples are decoded eagerly to discard the sample if the previous sample isn't the sample
+        // the delta was computed from. The value would otherwise be wrong until the next full update.
+        //
+        if(!applyDelta(previous, sample, communicator))
+        {
+            Ice::Warning out(communicator->getLogger());
+            out << "discarded delta sample " << sample->id << " from `" << sample->origin
+                << "', the previous sample isn't the sample the delta was computed from";
+            return false;
+        }
+        return true;
+    }
+
+    bool partialUpdate = sample->event == DataStorm::SampleEvent::PartialUpdate;
+    if(!_lazyDecode || (partialUpdate && ++_lazyUpdates > maxLazyUpdates))
+    {
+        _lazyUpdates = 0;
+        if(partialUpdate)
+        {
+            _parent->getUpdater(sample->tag)(previous, sample, communicator);
+        }
+        else
+        {
+            sample->decode(communicator);
+        }
+    }
+    else if(partialUpdate)
+    {
+        auto updater = _parent->getUpdater(sample->tag);
+        sample->setLazyDecoder([updater, previous, communicator](const shared_ptr<Sample>& next)
+        {
+            updater(previous, next, communicator);
+        });
+    }
+    else
+    {
+        _lazyUpdates = 0;
+        sample->setLazyDecoder([communicator](const shared_ptr<Sample>& next) { next->decode(communicator); });
+    }
+    return true;
+}
+
 DataWriterI::DataWriterI(TopicWriterI* topic,
                          const string& name,
                          long long int id,
                          const DataStorm::WriterConfig& config) :
     DataElementI(topic, name, id, config),
-    _parent(topic)
+    _parent(topic),
+    _samples(getHistoryCapacity(config)),
+    _deltaKeyFrameInterval(getDeltaKeyFrameInterval(config)),
+    _deltaCount(0),
+    _deltaId(0),
+    _compressionThreshold(config.compressionThreshold ? static_cast<size_t>(max(*config.compressionThreshold, 0)) : 1024),
+    _compressionContext({ { compressionContext, "" } }),
+    _flushInterval(config.flushInterval ? max(*config.flushInterval, 0) : 0),
+    _flushSize(config.flushSize ? static_cast<size_t>(max(*config.flushSize, 0)) : 0),
+    _highWaterMark(config.highWaterMark ? static_cast<size_t>(max(*config.highWaterMark, 0)) : 0),
+    _highWaterMarkBytes(config.highWaterMarkBytes ? static_cast<size_t>(max(*config.highWaterMarkBytes, 0)) : 0),
+    _overflowPolicy(config.overflowPolicy ? *config.overflowPolicy : DataStorm::OverflowPolicy::Block)
 {
     _config->priority = config.priority;
+    _compression = getCompression(config, topic->getInstance()->getCommunicator());
 }
 
 void
@@ -967,49 +1403,330 @@ DataWriterI::init()
 {
     DataElementI::init();
     _subscribers = Ice::uncheckedCast<DataStormContract::SubscriberSessionPrx>(_forwarder);
+    if(_highWaterMark > 0 || _highWaterMarkBytes > 0 || _overflowPolicy == DataStorm::OverflowPolicy::Conflate)
+    {
+        weak_ptr<DataElementI> self = shared_from_this();
+        auto notify = [self](const string& session, bool overflow)
+        {
+            auto writer = self.lock();
+            if(writer)
+            {
+                dynamic_pointer_cast<DataWriterI>(writer)->overflow(session, overflow);
+            }
+        };
+        //
+        // Without high-water mark, the conflate policy conflates the samples as soon as a sample request
+        // is waiting to be sent.
+        //
+        auto highWaterMark = _highWaterMark == 0 && _highWaterMarkBytes == 0 ? 1 : _highWaterMark;
+        _flowControl = make_shared<FlowControl>(highWaterMark, _highWaterMarkBytes, _overflowPolicy, move(notify),
+                                                getCommunicator(), _parent->getInstance()->getTimer());
+    }
 }
 
 void
 DataWriterI::publish(const shared_ptr<Key>& key, const shared_ptr<Sample>& sample)
 {
-    lock_guard<mutex> lock(_parent->_mutex);
-    if(sample->event == DataStorm::SampleEvent::PartialUpdate)
+    lock_guard<mutex> publishLock(_publishMutex);
+    auto data = prepare(key, sample, _last);
+    if(_flowControl && _overflowPolicy == DataStorm::OverflowPolicy::Block && _flowControl->hasOverflow())
     {
-        assert(!sample->hasValue());
-        _parent->getUpdater(sample->tag)(_last, sample, _parent->getInstance()->getCommunicator());
+        waitForFlowControl({ sample });
     }
 
-    sample->id = ++_parent->_nextSampleId;
-    sample->timestamp = chrono::system_clock::now();
+    lock_guard<mutex> lock(_parent->_mutex);
+    stamp(sample, data);
 
     if(_traceLevels->data > 2)
     {
         Trace out(_traceLevels, _traceLevels->dataCat);
         out << this << ": publishing sample " << sample->id << " listeners=" << _listenerCount;
     }
-    send(key, sample);
-
-    if(_config->sampleLifetime && *_config->sampleLifetime > 0)
+    if(_flushInterval > 0 || _flushSize > 1)
     {
-        cleanOldSamples(_samples, sample->timestamp, *_config->sampleLifetime);
+        coalesce(sample, move(data));
     }
-
-    if(_config->sampleCount)
+    else
     {
-        if(*_config->sampleCount > 0)
-        {
-            if(_samples.size() + 1 > static_cast<size_t>(*_config->sampleCount))
-            {
-                _samples.pop_front();
-            }
-        }
-        else if(*_config->sampleCount == 0)
-        {
-            return; // Don't keep history
-        }
+        send(sample, data);
     }
+    addToHistory(sample);
+}
 
-    if(_config->clearHistory &&
+void
+DataWriterI::publish(const vector<pair<shared_ptr<Key>, shared_ptr<Sample>>>& samples)
+{
+    if(samples.empty())
+    {
+        return;
+    }
+
+    lock_guard<mutex> publishLock(_publishMutex);
+    vector<shared_ptr<Sample>> batch;
+    DataSampleSeq data;
+    batch.reserve(samples.size());
+    shared_ptr<Sample> previous = _last;
+    for(const auto& s : samples)
+    {
+        data.push_back(prepare(s.first, s.second, previous));
+        batch.push_back(s.second);
+        previous = s.second;
+    }
+    if(_flowControl && _overflowPolicy == DataStorm::OverflowPolicy::Block && _flowControl->hasOverflow())
+    {
+        waitForFlowControl(batch);
+    }
+
+    lock_guard<mutex> lock(_parent->_mutex);
+    for(size_t i = 0; i < batch.size(); ++i)
+    {
+        stamp(batch[i], data[i]);
+    }
+
+    if(_traceLevels->data > 2)
+    {
+        Trace out(_traceLevels, _traceLevels->dataCat);
+        out << this << ": publishing " << batch.size() << " samples [" << batch.front()->id << "-"
+            << batch.back()->id << "] listeners=" << _listenerCount;
+    }
+    if(_flushInterval > 0 || _flushSize > 1)
+    {
+        for(size_t i = 0; i < batch.size(); ++i)
+        {
+            coalesce(batch[i], move(data[i]));
+        }
+    }
+    else
+    {
+        send(batch, move(data));
+    }
+    for(const auto& s : batch)
+    {
+        addToHistory(s);
+    }
+}
+
+void
+DataWriterI::flush()
+{
+    lock_guard<mutex> lock(_parent->_mutex);
+    flushPending();
+}
+
+void
+DataWriterI::onOverflow(function<void(string, bool)> callback)
+{
+    lock_guard<mutex> lock(_parent->_mutex);
+    _onOverflow = move(callback);
+}
+
+void
+DataWriterI::waitForFlowControl(const vector<shared_ptr<Sample>>& samples)
+{
+    //
+    // Called with the publish mutex locked. Only wait for the listeners the samples are sent to, a
+    // listener which reached the high-water mark doesn't block the samples sent to other listeners.
+    //
+    vector<shared_ptr<FlowControl::Listener>> listeners;
+    {
+        lock_guard<mutex> lock(_parent->_mutex);
+        listeners = getFlowControlListeners(samples);
+    }
+    _flowControl->wait(listeners);
+}
+
+DataSample
+DataWriterI::prepare(const shared_ptr<Key>& key, const shared_ptr<Sample>& sample, const shared_ptr<Sample>& previous)
+{
+    // Called with the publish mutex locked, the topic mutex is only locked to get the updater.
+    if(sample->event == DataStorm::SampleEvent::PartialUpdate)
+    {
+        assert(!sample->hasValue());
+        Topic::Updater updater;
+        {
+            lock_guard<mutex> lock(_parent->_mutex);
+            updater = _parent->getUpdater(sample->tag);
+        }
+        updater(previous, sample, _parent->getInstance()->getCommunicator());
+    }
+
+    sample->key = key ? key : getDefaultKey();
+    auto data = encode(sample);
+    if(_deltaKeyFrameInterval > 1)
+    {
+        encodeDelta(sample, data);
+    }
+    if(_compression != DataStorm::Compression::None)
+    {
+        data.value = compressValue(_compression, _compressionThreshold, data.value);
+    }
+    return data;
+}
+
+void
+DataWriterI::encodeDelta(const shared_ptr<Sample>& sample, DataSample& data)
+{
+    //
+    // Send the delta between the previous sample value and the sample value if smaller than the value. The
+    // delta is sent as a partial update with the delta tag, it carries the id of the base sample to allow
+    // readers to check that they apply it to the sample it was computed from.
+    //
+    // The delta is computed from the encoded value cached by the writer rather than from the previous sample
+    // encoding: the previous sample is in the history and its encoding is also accessed by getSamples with
+    // only the topic mutex locked.
+    //
+    auto communicator = _parent->getInstance()->getCommunicator();
+    vector<unsigned char> value;
+    if(sample->event == DataStorm::SampleEvent::PartialUpdate)
+    {
+        value = sample->encodeValue(communicator);
+    }
+    else if(sample->event != DataStorm::SampleEvent::Remove)
+    {
+        value = data.value;
+    }
+
+    if(sample->event == DataStorm::SampleEvent::Update)
+    {
+        if(_deltaKey == sample->key && ++_deltaCount < _deltaKeyFrameInterval)
+        {
+            auto delta = computeDelta(_deltaId, _deltaValue, data.value);
+            if(delta.size() < data.value.size())
+            {
+                data.event = DataStorm::SampleEvent::PartialUpdate;
+                data.tag = DeltaTagId;
+                data.value = move(delta);
+            }
+            else
+            {
+                _deltaCount = 0;
+            }
+        }
+        else
+        {
+            _deltaCount = 0;
+        }
+    }
+    _deltaKey = sample->event == DataStorm::SampleEvent::Remove ? nullptr : sample->key;
+    _deltaValue = move(value);
+    _deltaId = 0; // Set when the sample is stamped
+}
+
+void
+DataWriterI::stamp(const shared_ptr<Sample>& sample, DataSample& data)
+{
+    // Called with the topic mutex locked
+    sample->id = ++_parent->_nextSampleId;
+    _deltaId = sample->id;
+    sample->timestamp = chrono::system_clock::now();
+    data.id = sample->id;
+    data.timestamp = chrono::time_point_cast<chrono::microseconds>(sample->timestamp).time_since_epoch().count();
+}
+
+void
+DataWriterI::coalesce(const shared_ptr<Sample>& sample, DataSample data)
+{
+    _pending.push_back(sample);
+    _pendingSamples.push_back(move(data));
+    if(_flushSize > 0 && _pending.size() >= _flushSize)
+    {
+        flushPending();
+    }
+    else if(_flushInterval > 0 && _pending.size() == 1)
+    {
+        weak_ptr<DataElementI> self = shared_from_this();
+        _flushCanceller = _parent->getInstance()->getTimer()->schedule(chrono::milliseconds(_flushInterval), [self]
+        {
+            auto writer = self.lock();
+            if(writer)
+            {
+                dynamic_pointer_cast<DataWriterI>(writer)->flush();
+            }
+        });
+    }
+}
+
+void
+DataWriterI::flushPending()
+{
+    if(_flushCanceller)
+    {
+        _flushCanceller();
+        _flushCanceller = nullptr;
+    }
+    if(_pending.empty())
+    {
+        return;
+    }
+
+    if(_traceLevels->data > 2)
+    {
+        Trace out(_traceLevels, _traceLevels->dataCat);
+        out << this << ": flushing " << _pending.size() << " samples listeners=" << _listenerCount;
+    }
+
+    vector<shared_ptr<Sample>> pending;
+    DataSampleSeq pendingSamples;
+    pending.swap(_pending);
+    pendingSamples.swap(_pendingSamples);
+    if(pending.size() == 1)
+    {
+        send(pending[0], pendingSamples[0]);
+    }
+    else
+    {
+        send(pending, move(pendingSamples));
+    }
+}
+
+void
+DataWriterI::overflow(const string& session, bool overflow)
+{
+    //
+    // Called by the flow control when a listener crosses the high-water mark, the topic mutex might
+    // be locked. The callback is retrieved by the callback executor.
+    //
+    if(_traceLevels->data > 1)
+    {
+        Trace out(_traceLevels, _traceLevels->dataCat);
+        out << this << ": listener `" << session << "' " << (overflow ? "reached" : "dropped below")
+            << " the high-water mark";
+    }
+    auto self = shared_from_this();
+    _executor->queue(self, [self, session, overflow]
+    {
+        auto writer = dynamic_pointer_cast<DataWriterI>(self);
+        function<void(string, bool)> callback;
+        {
+            lock_guard<mutex> lock(writer->_parent->_mutex);
+            callback = writer->_onOverflow;
+        }
+        if(callback)
+        {
+            callback(session, overflow);
+        }
+    }, true);
+}
+
+void
+DataWriterI::addToHistory(const shared_ptr<Sample>& sample)
+{
+    if(_config->sampleCount)
+    {
+        if(*_config->sampleCount > 0)
+        {
+            if(_samples.size() + 1 > static_cast<size_t>(*_config->sampleCount))
+            {
+                _samples.pop_front();
+            }
+        }
+        else if(*_config->sampleCount == 0)
+        {
+            return; // Don't keep history
+        }
+    }
+
+    if(_config->clearHistory &&
        (*_config->clearHistory == ClearHistoryPolicy::OnAll ||
         (sample->event == DataStorm::SampleEvent::Add && *_config->clearHistory == ClearHistoryPolicy::OnAdd) ||
         (sample->event == DataStorm::SampleEvent::Remove && *_config->clearHistory == ClearHistoryPolicy::OnRemove) ||
@@ -1021,6 +1738,13 @@ DataWriterI::publish(const shared_ptr<Key>& key, const shared_ptr<Sample>& sampl
     assert(sample->key);
     _samples.push_back(sample);
     _last = sample;
+    scheduleExpiry(sample);
+}
+
+chrono::time_point<chrono::system_clock>
+DataWriterI::expireSamples(const chrono::time_point<chrono::system_clock>& now)
+{
+    return expireHistory(_samples, now, _config->sampleLifetime);
 }
 
 KeyDataReaderI::KeyDataReaderI(TopicReaderI* topic,
@@ -1116,8 +1840,15 @@ KeyDataWriterI::KeyDataWriterI(TopicWriterI* topic,
                                const vector<shared_ptr<Key>>& keys,
                                const DataStorm::WriterConfig& config) :
     DataWriterI(topic, name, id, config),
-    _keys(keys)
+    _keys(keys),
+    _sampleData(nullptr),
+    _delta(false)
 {
+    if(_keys.size() != 1)
+    {
+        // Index the history samples by key to speed up the retrieval of the initial samples of key readers.
+        _samples.enableKeyIndex();
+    }
     if(_traceLevels->data > 0)
     {
         Trace out(_traceLevels, _traceLevels->dataCat);
@@ -1133,6 +1864,11 @@ KeyDataWriterI::destroyImpl()
         Trace out(_traceLevels, _traceLevels->dataCat);
         out << this << ": destroyed key writer";
     }
+    flushPending();
+    if(_flowControl)
+    {
+        _flowControl->destroy();
+    }
     try
     {
         _forwarder->detachElements(_parent->getId(), { _keys.empty() ? -_id : _id });
@@ -1219,34 +1955,74 @@ KeyDataWriterI::getSamples(const shared_ptr<Key>& key,
         staleTime = now - chrono::milliseconds(*config->sampleLifetime);
     }
 
+    //
+    // Samples waiting to be flushed aren't returned, they will be sent to the new listener with the
+    // next flush.
+    //
+    long long int pendingId = _pending.empty() ? numeric_limits<long long int>::max() : _pending.front()->id;
+
+    auto communicator = getCommunicator();
     shared_ptr<Sample> first;
-    for(auto p = _samples.rbegin(); p != _samples.rend(); ++p)
+    auto addSample = [&](const shared_ptr<Sample>& sample)
     {
-        if((*p)->timestamp < staleTime)
+        // Returns false when no more samples should be added
+        if(sample->id >= pendingId)
         {
-            break;
+            return true;
         }
-        if((*p)->id <= lastId)
+        if(sample->timestamp < staleTime || sample->id <= lastId)
         {
-            break;
+            return false;
         }
 
-        if((!key || key == (*p)->key) && (!sampleFilter || sampleFilter->match(*p)))
+        if((!key || key == sample->key) && (!sampleFilter || sampleFilter->match(sample)))
         {
-            first = *p;
-            samples.samples.push_front(toSample(*p, getCommunicator(), _keys.empty()));
+            first = sample;
+            samples.samples.push_front(toSample(sample, communicator, _keys.empty()));
             if(config->sampleCount &&
                *config->sampleCount > 0 && static_cast<size_t>(*config->sampleCount) == samples.samples.size())
             {
-                break;
+                return false;
             }
 
             if(config->clearHistory &&
                (*config->clearHistory == ClearHistoryPolicy::OnAll ||
-                ((*p)->event == DataStorm::SampleEvent::Add && *config->clearHistory == ClearHistoryPolicy::OnAdd) ||
-                ((*p)->event == DataStorm::SampleEvent::Remove && *config->clearHistory == ClearHistoryPolicy::OnRemove) ||
-                ((*p)->event != DataStorm::SampleEvent::PartialUpdate &&
+                (sample->event == DataStorm::SampleEvent::Add && *config->clearHistory == ClearHistoryPolicy::OnAdd) ||
+                (sample->event == DataStorm::SampleEvent::Remove && *config->clearHistory == ClearHistoryPolicy::OnRemove) ||
+                (sample->event != DataStorm::SampleEvent::PartialUpdate &&
                      *config->clearHistory == ClearHistoryPolicy::OnAllExceptPartialUpdate)))
+            {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    if(key && _samples.hasKeyIndex())
+    {
+        //
+        // Only visit the samples of the key which are more recent than the last sample
+        // received by the reader.
+        //
+        auto keySamples = _samples.getKeySamples(key);
+        if(keySamples)
+        {
+            auto last = upper_bound(keySamples->begin(), keySamples->end(), lastId,
+                                    [](long long int id, const shared_ptr<Sample>& s) { return id < s->id; });
+            for(auto p = keySamples->rbegin(); p != make_reverse_iterator(last); ++p)
+            {
+                if(!addSample(*p))
+                {
+                    break;
+                }
+            }
+        }
+    }
+    else
+    {
+        for(auto p = _samples.rbegin(); p != _samples.rend(); ++p)
+        {
+            if(!addSample(*p))
             {
                 break;
             }
@@ -1270,27 +2046,522 @@ KeyDataWriterI::getSamples(const shared_ptr<Key>& key,
     return samples;
 }
 
+shared_ptr<Key>
+KeyDataWriterI::getDefaultKey() const
+{
+    assert(_keys.size() == 1);
+    return _keys[0];
+}
+
+DataSample
+KeyDataWriterI::encode(const shared_ptr<Sample>& sample) const
+{
+    return toSample(sample, getCommunicator(), _keys.empty());
+}
+
 void
-KeyDataWriterI::send(const shared_ptr<Key>& key, const shared_ptr<Sample>& sample) const
+KeyDataWriterI::send(const shared_ptr<Sample>& sample, const DataSample& data) const
 {
-    assert(key || _keys.size() == 1);
     _sample = sample;
-    _sample->key = key ? key : _keys[0];
-    _subscribers->s(_parent->getId(), _keys.empty() ? -_id : _id, toSample(sample, getCommunicator(), _keys.empty()));
+    _sampleData = &data;
+    _delta = data.tag == DeltaTagId;
+    _subscribers->s(_parent->getId(), _keys.empty() ? -_id : _id, data,
+                    _compression != DataStorm::Compression::None ? _compressionContext : Ice::noExplicitContext);
     _sample = nullptr;
+    _sampleData = nullptr;
+    _delta = false;
+}
+
+void
+KeyDataWriterI::send(const vector<shared_ptr<Sample>>& samples, DataSampleSeq data) const
+{
+    _batch = samples;
+    _batchSamples = move(data);
+    _delta = any_of(_batchSamples.begin(), _batchSamples.end(),
+                    [](const DataSample& sample) { return sample.tag == DeltaTagId; });
+    _subscribers->ss(_parent->getId(), _keys.empty() ? -_id : _id, _batchSamples,
+                     _compression != DataStorm::Compression::None ? _compressionContext : Ice::noExplicitContext);
+    _batch.clear();
+    _batchSamples.clear();
+    _delta = false;
 }
 
 void
 KeyDataWriterI::forward(const Ice::ByteSeq& inEncaps, const Ice::Current& current) const
 {
-    for(const auto& listener : _listeners)
+    //
+    // Sample requests are subject to flow control, keep a single copy of the request parameters
+    // for the listeners which need to queue the request.
+    //
+    shared_ptr<const Ice::ByteSeq> encaps;
+    if(_flowControl && (_sample || !_batch.empty()))
     {
-        // If there's at least one subscriber interested in the update (check the key if any writer)
-        if(!_sample || listener.second.matchOne(_sample, _keys.empty()))
+        encaps = make_shared<const Ice::ByteSeq>(inEncaps);
+    }
+
+    if(!_keys.empty() || (!_sample && _batch.empty()))
+    {
+        //
+        // The listeners of a key writer are all interested in the writer keys, only the sample
+        // filters need to be checked. The filter results are shared by the listeners.
+        //
+        FilterMatches filterMatches;
+        vector<FilterMatches> batchFilterMatches(_batch.size());
+        for(const auto& listener : _listeners)
         {
-            listener.second.proxy->ice_invokeAsync(current.operation, current.mode, inEncaps, current.ctx);
+            if(!_batch.empty())
+            {
+                vector<bool> matches(_batch.size());
+                for(size_t i = 0; i < _batch.size(); ++i)
+                {
+                    matches[i] = listener.second.matchOne(_batch[i], false, batchFilterMatches[i]) &&
+                        !throttle(listener.second, _batch[i], _batchSamples[i]);
+                }
+                forward(listener.second, matches, encaps, inEncaps, current);
+            }
+            // If there's at least one subscriber interested in the update
+            else if(!_sample ||
+                    (listener.second.matchOne(_sample, false, filterMatches) &&
+                     !throttle(listener.second, _sample, *_sampleData)))
+            {
+                invoke(listener.second, encaps, inEncaps, current);
+            }
+        }
+        return;
+    }
+
+    //
+    // For the any key writer, use the key listener index to only visit the listeners with
+    // subscribers interested in the sample key.
+    //
+    vector<const Listener*> listeners;
+    if(_sample)
+    {
+        FilterMatches filterMatches;
+        getKeyListeners(_sample, filterMatches, listeners);
+        for(const auto& listener : listeners)
+        {
+            if(!throttle(*listener, _sample, *_sampleData))
+            {
+                invoke(*listener, encaps, inEncaps, current);
+            }
+        }
+    }
+    else
+    {
+        map<const Listener*, vector<bool>> matches;
+        for(size_t i = 0; i < _batch.size(); ++i)
+        {
+            FilterMatches filterMatches;
+            getKeyListeners(_batch[i], filterMatches, listeners);
+            for(const auto& listener : listeners)
+            {
+                auto& m = matches[listener];
+                if(m.empty())
+                {
+                    m.resize(_batch.size());
+                }
+                m[i] = !throttle(*listener, _batch[i], _batchSamples[i]);
+            }
+        }
+        for(const auto& m : matches)
+        {
+            forward(*m.first, m.second, encaps, inEncaps, current);
+        }
+    }
+}
+
+void
+KeyDataWriterI::forward(const Listener& listener,
+                        const vector<bool>& matches,
+                        const shared_ptr<const Ice::ByteSeq>& encaps,
+                        const Ice::ByteSeq& inEncaps,
+                        const Ice::Current& current) const
+{
+    //
+    // Forward the batch as-is if the listener is interested in all its samples, otherwise
+    // only send the samples matching the listener subscribers.
+    //
+    auto count = static_cast<size_t>(std::count(matches.begin(), matches.end(), true));
+    if(count == _batch.size())
+    {
+        invoke(listener, encaps, inEncaps, current);
+    }
+    else if(count > 0 && !conflate(listener, &matches))
+    {
+        sendSamples(listener, collectSamples(listener, &matches), getRequestSamples(&matches));
+    }
+}
+
+void
+KeyDataWriterI::invoke(const Listener& listener,
+                       const shared_ptr<const Ice::ByteSeq>& encaps,
+                       const Ice::ByteSeq& inEncaps,
+                       const Ice::Current& current) const
+{
+    if(encaps && listener.flowControl && conflate(listener, nullptr))
+    {
+        return;
+    }
+    else if((_delta && listener.hasSampleFilter) ||
+            (_compression != DataStorm::Compression::None && !listener.compressed) ||
+            (!_batch.empty() && !listener.batches))
+    {
+        //
+        // The listener doesn't get the request sent by the writer, see getListenerSample and
+        // createSamplesRequest.
+        //
+        sendSamples(listener, collectSamples(listener, nullptr), getRequestSamples(nullptr));
+        return;
+    }
+    else if(!encaps || !listener.flowControl)
+    {
+        listener.proxy->ice_invokeAsync(current.operation, current.mode, inEncaps, current.ctx);
+        return;
+    }
+
+    //
+    // The request is accounted by the flow control until it's sent to the listener or fails.
+    //
+    auto proxy = listener.proxy;
+    auto operation = current.operation;
+    auto mode = current.mode;
+    auto ctx = current.ctx;
+    auto request = [proxy, operation, mode, encaps, ctx](function<void()> completed)
+    {
+        proxy->ice_invokeAsync(operation, mode, *encaps, [](bool, vector<Ice::Byte>) {},
+                               [completed](exception_ptr) { completed(); }, [completed](bool) { completed(); }, ctx);
+    };
+    _flowControl->send(listener.flowControl, encaps->size(), move(request), getRequestSamples(nullptr));
+}
+
+void
+KeyDataWriterI::sendSamples(const Listener& listener,
+                            DataSampleSeq samples,
+                            FlowControl::RequestSamples requestSamples) const
+{
+    auto subscriber = Ice::uncheckedCast<SubscriberSessionPrx>(listener.proxy);
+    auto topicId = _parent->getId();
+    auto elementId = _keys.empty() ? -_id : _id;
+    auto ctx = listener.compressed ? _compressionContext : Ice::noExplicitContext;
+    size_t size = 0;
+    for(const auto& sample : samples)
+    {
+        size += sample.value.size();
+    }
+    auto request = createSamplesRequest(subscriber, topicId, elementId, make_shared<DataSampleSeq>(move(samples)),
+                                        ctx, listener.batches);
+    if(!listener.flowControl)
+    {
+        request([] {});
+        return;
+    }
+    _flowControl->send(listener.flowControl, size, move(request), move(requestSamples));
+}
+
+FlowControl::RequestSamples
+KeyDataWriterI::getRequestSamples(const vector<bool>* matches) const
+{
+    // The keys and events of the samples sent to a listener, only needed by the drop oldest policy.
+    FlowControl::RequestSamples samples;
+    if(!_flowControl || _flowControl->getPolicy() != DataStorm::OverflowPolicy::DropOldest)
+    {
+        return samples;
+    }
+
+    if(_sample)
+    {
+        samples.emplace_back(_sample->key, _sampleData->event == DataStorm::SampleEvent::Update);
+    }
+    else
+    {
+        for(size_t i = 0; i < _batch.size(); ++i)
+        {
+            if(!matches || (*matches)[i])
+            {
+                samples.emplace_back(_batch[i]->key, _batchSamples[i].event == DataStorm::SampleEvent::Update);
+            }
+        }
+    }
+    return samples;
+}
+
+vector<shared_ptr<FlowControl::Listener>>
+KeyDataWriterI::getFlowControlListeners(const vector<shared_ptr<Sample>>& samples) const
+{
+    // Called with the topic mutex locked, returns the flow control of the listeners interested in the samples.
+    set<shared_ptr<FlowControl::Listener>> flowControls;
+    for(const auto& sample : samples)
+    {
+        FilterMatches filterMatches;
+        if(!_keys.empty())
+        {
+            for(const auto& listener : _listeners)
+            {
+                if(listener.second.flowControl && listener.second.matchOne(sample, false, filterMatches))
+                {
+                    flowControls.insert(listener.second.flowControl);
+                }
+            }
+        }
+        else
+        {
+            vector<const Listener*> listeners;
+            getKeyListeners(sample, filterMatches, listeners);
+            for(const auto& listener : listeners)
+            {
+                if(listener->flowControl)
+                {
+                    flowControls.insert(listener->flowControl);
+                }
+            }
         }
     }
+    return vector<shared_ptr<FlowControl::Listener>>(flowControls.begin(), flowControls.end());
+}
+
+DataSampleSeq
+KeyDataWriterI::collectSamples(const Listener& listener, const vector<bool>* matches) const
+{
+    DataSampleSeq samples;
+    if(_sample)
+    {
+        samples.push_back(getListenerSample(listener, _sample, *_sampleData));
+    }
+    else
+    {
+        for(size_t i = 0; i < _batch.size(); ++i)
+        {
+            if(!matches || (*matches)[i])
+            {
+                samples.push_back(getListenerSample(listener, _batch[i], _batchSamples[i]));
+            }
+        }
+    }
+    return samples;
+}
+
+DataSample
+KeyDataWriterI::getListenerSample(const Listener& listener, const shared_ptr<Sample>& sample,
+                                  const DataSample& data) const
+{
+    //
+    // Delta samples are sent as full updates to listeners with sample filters and the compressed values
+    // are decompressed for listeners which don't support the writer compression.
+    //
+    if(listener.hasSampleFilter && data.tag == DeltaTagId)
+    {
+        return foldSample(sample, data, nullptr, listener.compressed, getCommunicator());
+    }
+    else if(_compression == DataStorm::Compression::None || listener.compressed)
+    {
+        return data;
+    }
+
+    return { data.id, data.keyId, data.keyValue, data.timestamp, data.tag, data.event, decompressValue(data.value, 0) };
+}
+
+bool
+KeyDataWriterI::conflate(const Listener& listener, const vector<bool>* matches) const
+{
+    if(!listener.flowControl || _flowControl->getPolicy() != DataStorm::OverflowPolicy::Conflate)
+    {
+        return false;
+    }
+
+    //
+    // The flow control conflates the samples sent to the listener, the values are decompressed first if the
+    // listener doesn't support the writer compression.
+    //
+    DataSampleSeq uncompressed;
+    if(_compression != DataStorm::Compression::None && !listener.compressed)
+    {
+        uncompressed = collectSamples(listener, matches);
+    }
+
+    vector<pair<shared_ptr<Sample>, const DataSample*>> samples;
+    if(_sample)
+    {
+        samples.emplace_back(_sample, uncompressed.empty() ? _sampleData : &uncompressed[0]);
+    }
+    else
+    {
+        for(size_t i = 0; i < _batch.size(); ++i)
+        {
+            if(!matches || (*matches)[i])
+            {
+                samples.emplace_back(_batch[i],
+                                     uncompressed.empty() ? &_batchSamples[i] : &uncompressed[samples.size()]);
+            }
+        }
+    }
+    return conflate(listener, samples);
+}
+
+bool
+KeyDataWriterI::conflate(const Listener& listener,
+                         const vector<pair<shared_ptr<Sample>, const DataSample*>>& samples) const
+{
+    if(!listener.flowControl || _flowControl->getPolicy() != DataStorm::OverflowPolicy::Conflate)
+    {
+        return false;
+    }
+
+    auto subscriber = Ice::uncheckedCast<SubscriberSessionPrx>(listener.proxy);
+    auto topicId = _parent->getId();
+    auto elementId = _keys.empty() ? -_id : _id;
+    auto ctx = listener.compressed ? _compressionContext : Ice::noExplicitContext;
+    auto batches = listener.batches;
+    auto batch = [subscriber, topicId, elementId, ctx, batches](DataSampleSeq conflated)
+    {
+        return createSamplesRequest(subscriber, topicId, elementId, make_shared<DataSampleSeq>(move(conflated)), ctx,
+                                    batches);
+    };
+    return _flowControl->conflate(listener.flowControl, samples, batch);
+}
+
+bool
+KeyDataWriterI::throttle(const Listener& listener, const shared_ptr<Sample>& sample, const DataSample& data) const
+{
+    // Called with the topic mutex locked, returns true if the sample isn't sent to the listener.
+    if(!listener.throttle)
+    {
+        return false;
+    }
+    auto interval = listener.getMinSampleInterval();
+    if(interval.count() == 0)
+    {
+        // A subscriber without minimum sample interval is attached, the pending sample is outdated.
+        listener.throttle->keys.erase(sample->key);
+        return false;
+    }
+
+    auto now = chrono::steady_clock::now();
+    auto& pending = listener.throttle->keys[sample->key];
+    if(sample->event == DataStorm::SampleEvent::Add || sample->event == DataStorm::SampleEvent::Remove)
+    {
+        // Add and remove samples are always sent, they replace the pending sample.
+        pending.sample = nullptr;
+        pending.sendTime = now;
+        return false;
+    }
+    else if(!pending.sample && now - pending.sendTime >= interval)
+    {
+        pending.sendTime = now;
+        return false;
+    }
+
+    //
+    // Keep the latest sample until the interval elapsed. If a sample is pending, it's replaced even if
+    // the interval elapsed: the pending sample must be sent first since the partial updates and deltas
+    // of this sample might be computed from the pending sample.
+    //
+    pending.sample = sample;
+    pending.data = data;
+    if(!listener.throttle->scheduled)
+    {
+        listener.throttle->scheduled = true;
+        scheduleThrottle(listener.throttle, pending.sendTime + interval - now);
+    }
+    return true;
+}
+
+void
+KeyDataWriterI::scheduleThrottle(const shared_ptr<Throttle>& throttle, chrono::steady_clock::duration delay) const
+{
+    auto timeout = chrono::duration_cast<chrono::milliseconds>(delay);
+    if(timeout < delay)
+    {
+        ++timeout;
+    }
+    weak_ptr<const DataElementI> self = shared_from_this();
+    _parent->getInstance()->getTimer()->schedule(max(timeout, chrono::milliseconds(0)), [self, throttle]
+    {
+        auto writer = self.lock();
+        if(writer)
+        {
+            dynamic_pointer_cast<const KeyDataWriterI>(writer)->flushThrottle(throttle);
+        }
+    });
+}
+
+void
+KeyDataWriterI::flushThrottle(const shared_ptr<Throttle>& throttle) const
+{
+    lock_guard<mutex> lock(_parent->_mutex);
+    throttle->scheduled = false;
+    auto p = _listeners.find(throttle->listener);
+    if(p == _listeners.end() || p->second.throttle != throttle)
+    {
+        return;
+    }
+    const auto& listener = p->second;
+
+    //
+    // Send the pending samples whose interval elapsed and schedule the timer for the next pending
+    // sample. The keys without pending sample are removed once the interval elapsed.
+    //
+    auto communicator = getCommunicator();
+    auto interval = listener.getMinSampleInterval();
+    auto now = chrono::steady_clock::now();
+    auto next = chrono::steady_clock::time_point::max();
+    DataSampleSeq samples;
+    vector<shared_ptr<Sample>> sent;
+    for(auto q = throttle->keys.begin(); q != throttle->keys.end();)
+    {
+        auto& pending = q->second;
+        if(pending.sample && now - pending.sendTime >= interval)
+        {
+            samples.push_back(foldSample(pending.sample, getListenerSample(listener, pending.sample, pending.data),
+                                         nullptr, listener.compressed, communicator));
+            sent.push_back(move(pending.sample));
+            pending.sample = nullptr;
+            pending.sendTime = now;
+        }
+        else if(pending.sample)
+        {
+            next = min(next, pending.sendTime + interval);
+        }
+        else if(now - pending.sendTime >= interval)
+        {
+            q = throttle->keys.erase(q);
+            continue;
+        }
+        ++q;
+    }
+
+    if(!samples.empty())
+    {
+        if(_traceLevels->data > 2)
+        {
+            Trace out(_traceLevels, _traceLevels->dataCat);
+            out << this << ": sending " << samples.size() << " rate limited samples";
+        }
+
+        vector<pair<shared_ptr<Sample>, const DataSample*>> conflated;
+        for(size_t i = 0; i < samples.size(); ++i)
+        {
+            conflated.emplace_back(sent[i], &samples[i]);
+        }
+        if(!conflate(listener, conflated))
+        {
+            FlowControl::RequestSamples requestSamples;
+            if(_flowControl && _flowControl->getPolicy() == DataStorm::OverflowPolicy::DropOldest)
+            {
+                for(size_t i = 0; i < samples.size(); ++i)
+                {
+                    requestSamples.emplace_back(sent[i]->key, samples[i].event == DataStorm::SampleEvent::Update);
+                }
+            }
+            sendSamples(listener, move(samples), move(requestSamples));
+        }
+    }
+
+    if(next != chrono::steady_clock::time_point::max())
+    {
+        throttle->scheduled = true;
+        scheduleThrottle(throttle, next - now);
+    }
 }
 
 FilteredDataReaderI::FilteredDataReaderI(TopicReaderI* topic,
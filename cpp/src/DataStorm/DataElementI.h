@@ -6,8 +6,13 @@
 #include <DataStorm/InternalI.h>
 #include <DataStorm/ForwarderManager.h>
 #include <DataStorm/Contract.h>
+#include <DataStorm/SampleHistory.h>
+#include <DataStorm/FlowControl.h>
 
-#include <deque>
+#include <algorithm>
+#include <condition_variable>
+#include <limits>
+#include <unordered_map>
 
 namespace DataStormI
 {
@@ -29,8 +34,10 @@ protected:
                    const std::shared_ptr<Filter>& filter,
                    const std::shared_ptr<Filter>& sampleFilter,
                    const std::string& name,
-                   int priority) :
-            id(id), filter(filter), sampleFilter(sampleFilter), name(name), priority(priority)
+                   int priority,
+                   int minSampleInterval) :
+            id(id), filter(filter), sampleFilter(sampleFilter), name(name), priority(priority),
+            minSampleInterval(minSampleInterval)
         {
         }
 
@@ -42,10 +49,9 @@ protected:
         std::shared_ptr<Filter> sampleFilter;
         std::string name;
         int priority;
+        int minSampleInterval;
     };
 
-private:
-
     struct ListenerKey
     {
         std::shared_ptr<SessionI> session;
@@ -65,20 +71,68 @@ private:
         }
     };
 
+    //
+    // The rate limiting state of a listener whose subscribers have a minimum sample interval. The
+    // latest sample of each key published within the interval is kept until the interval elapsed.
+    // The throttle holds the key of its listener to find it back when the timer fires.
+    //
+    struct Throttle
+    {
+        struct Pending
+        {
+            std::chrono::steady_clock::time_point sendTime;
+            std::shared_ptr<Sample> sample;
+            DataStormContract::DataSample data;
+        };
+
+        Throttle(const ListenerKey& listener) : listener(listener), scheduled(false)
+        {
+        }
+
+        const ListenerKey listener;
+        std::map<std::shared_ptr<Key>, Pending> keys;
+        bool scheduled;
+    };
+
+    //
+    // The results of the filters evaluated for a sample forwarded to the listeners. Subscribers with
+    // the same filter criteria share the same filter, each distinct filter is evaluated once for the
+    // sample regardless of the number of subscribers.
+    //
+    struct FilterMatches
+    {
+        bool match(const std::shared_ptr<Filter>& filter, const std::shared_ptr<Filterable>& value)
+        {
+            auto p = matches.find(filter.get());
+            if(p == matches.end())
+            {
+                p = matches.emplace(filter.get(), filter->match(value)).first;
+            }
+            return p->second;
+        }
+
+        std::unordered_map<const Filter*, bool> matches;
+    };
+
     struct Listener
     {
-        Listener(const std::shared_ptr<DataStormContract::SessionPrx>& proxy, const std::string& facet) :
-            proxy(facet.empty() ? proxy : Ice::uncheckedCast<DataStormContract::SessionPrx>(proxy->ice_facet(facet)))
+        Listener(const std::shared_ptr<DataStormContract::SessionPrx>& proxy, const std::string& facet,
+                 bool compressed, bool batches) :
+            proxy(facet.empty() ? proxy : Ice::uncheckedCast<DataStormContract::SessionPrx>(proxy->ice_facet(facet))),
+            compressed(compressed),
+            batches(batches),
+            minSampleInterval(0),
+            hasSampleFilter(false)
         {
         }
 
-        bool matchOne(const std::shared_ptr<Sample>& sample, bool matchKey) const
+        bool matchOne(const std::shared_ptr<Sample>& sample, bool matchKey, FilterMatches& filterMatches) const
         {
             for(const auto& s : subscribers)
             {
                 if((!matchKey || s.second->keys.empty() || s.second->keys.find(sample->key) != s.second->keys.end()) &&
-                   (!s.second->filter || s.second->filter->match(sample->key)) &&
-                   (!s.second->sampleFilter || s.second->sampleFilter->match(sample)))
+                   (!s.second->filter || filterMatches.match(s.second->filter, sample->key)) &&
+                   (!s.second->sampleFilter || filterMatches.match(s.second->sampleFilter, sample)))
                 {
                     return true;
                 }
@@ -93,6 +147,7 @@ private:
                                              const std::shared_ptr<Filter>& sampleFilter,
                                              const std::string& name,
                                              int priority,
+                                             int minSampleInterval,
                                              bool& added)
         {
             auto k = std::make_pair(topicId, elementId);
@@ -100,11 +155,19 @@ private:
             if(p == subscribers.end())
             {
                 added = true;
-                p = subscribers.emplace(k, std::make_shared<Subscriber>(id, filter, sampleFilter, name, priority)).first;
+                auto subscriber = std::make_shared<Subscriber>(id, filter, sampleFilter, name, priority,
+                                                               minSampleInterval);
+                p = subscribers.emplace(k, std::move(subscriber)).first;
+                updateSubscribers();
             }
             return p->second;
         }
 
+        std::chrono::milliseconds getMinSampleInterval() const
+        {
+            return std::chrono::milliseconds(minSampleInterval);
+        }
+
         std::shared_ptr<Subscriber> get(long long int topicId, long long int elementId)
         {
             return subscribers.find(std::make_pair(topicId, elementId))->second;
@@ -113,11 +176,46 @@ private:
         bool remove(long long int topicId, long long int elementId)
         {
             subscribers.erase(std::make_pair(topicId, elementId));
+            updateSubscribers();
             return subscribers.empty();
         }
 
+        void updateSubscribers()
+        {
+            // Samples are only rate limited if all the subscribers have a minimum sample interval.
+            minSampleInterval = subscribers.empty() ? 0 : std::numeric_limits<int>::max();
+            hasSampleFilter = false;
+            for(const auto& s : subscribers)
+            {
+                minSampleInterval = std::min(minSampleInterval, s.second->minSampleInterval);
+                hasSampleFilter |= s.second->sampleFilter != nullptr;
+            }
+        }
+
         std::shared_ptr<DataStormContract::SessionPrx> proxy;
+
+        //
+        // True if the listener node supports the writer compression, the sample values are sent to the
+        // listener with the compression byte.
+        //
+        bool compressed;
+
+        //
+        // True if the listener node supports the ss operation, the samples are otherwise sent to the listener
+        // with an s request per sample.
+        //
+        bool batches;
+
         std::map<std::pair<long long int, long long int>, std::shared_ptr<Subscriber>> subscribers;
+        std::shared_ptr<FlowControl::Listener> flowControl;
+        std::shared_ptr<Throttle> throttle;
+        int minSampleInterval;
+
+        //
+        // Listeners with sample filters might not receive the sample a delta is computed from, delta
+        // samples are sent to them as full updates.
+        //
+        bool hasSampleFilter;
     };
 
 public:
@@ -158,7 +256,9 @@ public:
                    const std::string&,
                    long long int,
                    const std::string&,
-                   int);
+                   int,
+                   int,
+                   const DataStormContract::ElementConfig&);
 
     void detachKey(long long int,
                    long long int,
@@ -177,7 +277,9 @@ public:
                       long long int,
                       const std::shared_ptr<Filter>&,
                       const std::string&,
-                      int);
+                      int,
+                      int,
+                      const DataStormContract::ElementConfig&);
 
     void detachFilter(long long int,
                       long long int,
@@ -204,6 +306,9 @@ public:
     virtual void queue(const std::shared_ptr<Sample>&, int, const std::shared_ptr<SessionI>&, const std::string&,
                        const std::chrono::time_point<std::chrono::system_clock>&, bool);
 
+    virtual std::chrono::time_point<std::chrono::system_clock>
+    expireSamples(const std::chrono::time_point<std::chrono::system_clock>&);
+
     virtual std::string toString() const = 0;
     virtual std::shared_ptr<Ice::Communicator> getCommunicator() const override;
 
@@ -216,6 +321,7 @@ public:
 
     void waitForListeners(int count) const;
     bool hasListeners() const;
+    void shutdown() const;
 
     TopicI* getTopic() const
     {
@@ -227,10 +333,18 @@ protected:
     virtual bool addConnectedKey(const std::shared_ptr<Key>&, const std::shared_ptr<Subscriber>&);
     virtual bool removeConnectedKey(const std::shared_ptr<Key>&, const std::shared_ptr<Subscriber>&);
 
+    Listener createListener(const std::shared_ptr<DataStormContract::SessionPrx>&, const std::string&,
+                            const DataStormContract::ElementConfig&) const;
+    void addKeyListener(const std::shared_ptr<Key>&, const Listener&, const std::shared_ptr<Subscriber>&);
+    void removeKeyListener(const std::shared_ptr<Key>&, const Listener&, const std::shared_ptr<Subscriber>&);
+    void getKeyListeners(const std::shared_ptr<Sample>&, FilterMatches&, std::vector<const Listener*>&) const;
+
     void notifyListenerWaiters(std::unique_lock<std::mutex>&) const;
     void disconnect();
     virtual void destroyImpl() = 0;
 
+    void scheduleExpiry(const std::shared_ptr<Sample>&);
+
     const std::shared_ptr<TraceLevels> _traceLevels;
     const std::string _name;
     const long long int _id;
@@ -243,6 +357,29 @@ protected:
     std::map<std::shared_ptr<Key>, std::vector<std::shared_ptr<Subscriber>>> _connectedKeys;
     std::map<ListenerKey, Listener> _listeners;
 
+    //
+    // The flow control of the sample requests sent to the listeners, only set for writers with a
+    // high-water mark.
+    //
+    std::shared_ptr<FlowControl> _flowControl;
+
+    //
+    // The compression of the sample values sent to the listeners, only set for writers.
+    //
+    DataStorm::Compression _compression;
+
+    //
+    // Index of the listeners by subscribed key. Subscribers without keys are indexed with
+    // the null key.
+    //
+    std::map<std::shared_ptr<Key>, std::map<const Listener*, std::vector<std::shared_ptr<Subscriber>>>> _keyListeners;
+
+    //
+    // The condition variable used with the topic mutex to wait for the element state to change. Each
+    // element has its own condition variable to only wake up the threads waiting on this element.
+    //
+    mutable std::condition_variable _cond;
+
 private:
 
     virtual void forward(const Ice::ByteSeq&, const Ice::Current&) const;
@@ -266,10 +403,14 @@ public:
     virtual int getInstanceCount() const override;
 
     virtual std::vector<std::shared_ptr<Sample>> getAllUnread() override;
+    virtual void takeUnread(size_t, std::vector<std::shared_ptr<Sample>>&) override;
     virtual void waitForUnread(unsigned int) const override;
     virtual bool hasUnread() const override;
     virtual std::shared_ptr<Sample> getNextUnread() override;
 
+    virtual std::shared_ptr<Sample> getLast(const std::shared_ptr<Key>&) const override;
+    virtual std::vector<std::shared_ptr<Sample>> getAllLast() const override;
+
     virtual void initSamples(const std::vector<std::shared_ptr<Sample>>&, long long int, long long int, int,
                              const std::chrono::time_point<std::chrono::system_clock>&, bool) override;
     virtual void queue(const std::shared_ptr<Sample>&, int, const std::shared_ptr<SessionI>&, const std::string&,
@@ -277,20 +418,34 @@ public:
 
     virtual void onSamples(std::function<void(const std::vector<std::shared_ptr<Sample>>&)>,
                            std::function<void(const std::shared_ptr<Sample>&)>) override;
+    virtual void onSampleBatch(std::function<void(const std::vector<std::shared_ptr<Sample>>&)>) override;
+
+    virtual std::chrono::time_point<std::chrono::system_clock>
+    expireSamples(const std::chrono::time_point<std::chrono::system_clock>&) override;
 
 protected:
 
     virtual bool matchKey(const std::shared_ptr<Key>&) const = 0;
     virtual bool addConnectedKey(const std::shared_ptr<Key>&, const std::shared_ptr<Subscriber>&) override;
+    bool decodeSample(const std::shared_ptr<Sample>&, const std::shared_ptr<Sample>&);
+    void queueSampleBatch(bool);
+    void cacheLastValue(const std::shared_ptr<Sample>&);
 
     TopicReaderI* _parent;
 
-    std::deque<std::shared_ptr<Sample>> _samples;
+    SampleHistory _samples;
     std::shared_ptr<Sample> _last;
     int _instanceCount;
     DataStorm::DiscardPolicy _discardPolicy;
+    const bool _lazyDecode;
+    size_t _lazyUpdates;
+    const bool _lastValueCache;
+    std::unordered_map<std::shared_ptr<Key>, std::shared_ptr<Sample>> _lastValues;
     std::chrono::time_point<std::chrono::system_clock> _lastSendTime;
     std::function<void(const std::shared_ptr<Sample>&)> _onSamples;
+    std::function<void(const std::vector<std::shared_ptr<Sample>>&)> _onSampleBatch;
+    std::vector<std::shared_ptr<Sample>> _sampleBatch;
+    bool _sampleBatchQueued;
 };
 
 class DataWriterI : public DataElementI, public DataWriter
@@ -301,15 +456,68 @@ public:
     void init();
 
     virtual void publish(const std::shared_ptr<Key>&, const std::shared_ptr<Sample>&) override;
+    virtual void publish(const std::vector<std::pair<std::shared_ptr<Key>, std::shared_ptr<Sample>>>&) override;
+    virtual void flush() override;
+    virtual void onOverflow(std::function<void(std::string, bool)>) override;
+
+    virtual std::chrono::time_point<std::chrono::system_clock>
+    expireSamples(const std::chrono::time_point<std::chrono::system_clock>&) override;
 
 protected:
 
-    virtual void send(const std::shared_ptr<Key>&, const std::shared_ptr<Sample>&) const = 0;
+    void waitForFlowControl(const std::vector<std::shared_ptr<Sample>>&);
+    DataStormContract::DataSample prepare(const std::shared_ptr<Key>&, const std::shared_ptr<Sample>&,
+                                          const std::shared_ptr<Sample>&);
+    void encodeDelta(const std::shared_ptr<Sample>&, DataStormContract::DataSample&);
+    void stamp(const std::shared_ptr<Sample>&, DataStormContract::DataSample&);
+    void addToHistory(const std::shared_ptr<Sample>&);
+    void coalesce(const std::shared_ptr<Sample>&, DataStormContract::DataSample);
+    void flushPending();
+    void overflow(const std::string&, bool);
+
+    virtual std::shared_ptr<Key> getDefaultKey() const = 0;
+    virtual DataStormContract::DataSample encode(const std::shared_ptr<Sample>&) const = 0;
+    virtual void send(const std::shared_ptr<Sample>&, const DataStormContract::DataSample&) const = 0;
+    virtual void send(const std::vector<std::shared_ptr<Sample>>&, DataStormContract::DataSampleSeq) const = 0;
+    virtual std::vector<std::shared_ptr<FlowControl::Listener>>
+    getFlowControlListeners(const std::vector<std::shared_ptr<Sample>>&) const = 0;
 
     TopicWriterI* _parent;
     std::shared_ptr<DataStormContract::SubscriberSessionPrx> _subscribers;
-    std::deque<std::shared_ptr<Sample>> _samples;
+    SampleHistory _samples;
     std::shared_ptr<Sample> _last;
+
+    //
+    // Serializes the publishing of samples by this writer. The samples are prepared and encoded
+    // with only this mutex locked, the topic mutex is locked to assign the sample ids and send
+    // the samples.
+    //
+    std::mutex _publishMutex;
+
+    const int _deltaKeyFrameInterval;
+    int _deltaCount;
+
+    //
+    // The key, encoded value and id of the last prepared sample, the base of the next delta. It's
+    // only accessed with the publish mutex locked. The id is 0 until the sample is stamped.
+    //
+    std::shared_ptr<Key> _deltaKey;
+    std::vector<unsigned char> _deltaValue;
+    long long int _deltaId;
+
+    const size_t _compressionThreshold;
+    const Ice::Context _compressionContext;
+
+    const int _flushInterval;
+    const size_t _flushSize;
+    std::vector<std::shared_ptr<Sample>> _pending;
+    DataStormContract::DataSampleSeq _pendingSamples;
+    std::function<void()> _flushCanceller;
+
+    const size_t _highWaterMark;
+    const size_t _highWaterMarkBytes;
+    const DataStorm::OverflowPolicy _overflowPolicy;
+    std::function<void(std::string, bool)> _onOverflow;
 };
 
 class KeyDataReaderI : public DataReaderI
@@ -357,10 +565,34 @@ public:
 
 private:
 
-    virtual void send(const std::shared_ptr<Key>&, const std::shared_ptr<Sample>&) const override;
+    virtual std::shared_ptr<Key> getDefaultKey() const override;
+    virtual DataStormContract::DataSample encode(const std::shared_ptr<Sample>&) const override;
+    virtual void send(const std::shared_ptr<Sample>&, const DataStormContract::DataSample&) const override;
+    virtual void send(const std::vector<std::shared_ptr<Sample>>&, DataStormContract::DataSampleSeq) const override;
     virtual void forward(const Ice::ByteSeq&, const Ice::Current&) const override;
+    void forward(const Listener&, const std::vector<bool>&, const std::shared_ptr<const Ice::ByteSeq>&,
+                 const Ice::ByteSeq&, const Ice::Current&) const;
+    void invoke(const Listener&, const std::shared_ptr<const Ice::ByteSeq>&, const Ice::ByteSeq&,
+                const Ice::Current&) const;
+    void sendSamples(const Listener&, DataStormContract::DataSampleSeq, FlowControl::RequestSamples) const;
+    FlowControl::RequestSamples getRequestSamples(const std::vector<bool>*) const;
+    virtual std::vector<std::shared_ptr<FlowControl::Listener>>
+    getFlowControlListeners(const std::vector<std::shared_ptr<Sample>>&) const override;
+    DataStormContract::DataSampleSeq collectSamples(const Listener&, const std::vector<bool>*) const;
+    DataStormContract::DataSample getListenerSample(const Listener&, const std::shared_ptr<Sample>&,
+                                                    const DataStormContract::DataSample&) const;
+    bool conflate(const Listener&, const std::vector<bool>*) const;
+    bool conflate(const Listener&,
+                  const std::vector<std::pair<std::shared_ptr<Sample>, const DataStormContract::DataSample*>>&) const;
+    bool throttle(const Listener&, const std::shared_ptr<Sample>&, const DataStormContract::DataSample&) const;
+    void scheduleThrottle(const std::shared_ptr<Throttle>&, std::chrono::steady_clock::duration) const;
+    void flushThrottle(const std::shared_ptr<Throttle>&) const;
 
     const std::vector<std::shared_ptr<Key>> _keys;
+    mutable const DataStormContract::DataSample* _sampleData;
+    mutable std::vector<std::shared_ptr<Sample>> _batch;
+    mutable DataStormContract::DataSampleSeq _batchSamples;
+    mutable bool _delta;
 };
 
 class FilteredDataReaderI : public DataReaderI
@@ -0,0 +1,268 @@
+//
+// Copyright (c) ZeroC, Inc. All rights reserved.
+//
+#include <DataStorm/Delta.h>
+
+using namespace std;
+using namespace DataStormI;
+
+namespace
+{
+
+//
+// Differing bytes separated by less than this number of identical bytes are sent with a single
+// segment.
+//
+const size_t segmentGap = 8;
+
+class DeltaTag : public Tag
+{
+public:
+
+    virtual string toString() const override
+    {
+        return "delta";
+    }
+
+    virtual vector<unsigned char> encode(const shared_ptr<Ice::Communicator>&) const override
+    {
+        return {};
+    }
+
+    virtual long long int getId() const override
+    {
+        return DeltaTagId;
+    }
+};
+
+unsigned long long int
+hashValue(const vector<unsigned char>& value)
+{
+    // FNV-1a
+    unsigned long long int hash = 14695981039346656037ULL;
+    for(auto b : value)
+    {
+        hash ^= b;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+void
+writeSize(vector<unsigned char>& out, size_t value)
+{
+    while(value >= 0x80)
+    {
+        out.push_back(static_cast<unsigned char>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<unsigned char>(value));
+}
+
+bool
+readSize(const vector<unsigned char>& in, size_t& pos, size_t& value)
+{
+    value = 0;
+    for(size_t shift = 0; pos < in.size() && shift < sizeof(size_t) * 8; shift += 7)
+    {
+        auto b = in[pos++];
+        value |= static_cast<size_t>(b & 0x7f) << shift;
+        if(!(b & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void
+writeHash(vector<unsigned char>& out, unsigned long long int hash)
+{
+    for(size_t i = 0; i < sizeof(hash); ++i)
+    {
+        out.push_back(static_cast<unsigned char>(hash >> (i * 8)));
+    }
+}
+
+bool
+readHash(const vector<unsigned char>& in, size_t& pos, unsigned long long int& hash)
+{
+    if(in.size() - pos < sizeof(hash))
+    {
+        return false;
+    }
+    hash = 0;
+    for(size_t i = 0; i < sizeof(hash); ++i)
+    {
+        hash |= static_cast<unsigned long long int>(in[pos++]) << (i * 8);
+    }
+    return true;
+}
+
+bool
+applyDeltaValue(const vector<unsigned char>& base,
+                const vector<unsigned char>& delta,
+                size_t pos,
+                vector<unsigned char>& value)
+{
+    size_t baseSize;
+    unsigned long long int hash;
+    size_t size;
+    size_t prefix;
+    size_t suffix;
+    size_t count;
+    if(!readSize(delta, pos, baseSize) || baseSize != base.size() ||
+       !readHash(delta, pos, hash) || hash != hashValue(base) ||
+       !readSize(delta, pos, size) ||
+       !readSize(delta, pos, prefix) ||
+       !readSize(delta, pos, suffix) ||
+       prefix > size || suffix > size - prefix || prefix > baseSize || suffix > baseSize - prefix ||
+       !readSize(delta, pos, count))
+    {
+        return false;
+    }
+
+    if(size == baseSize)
+    {
+        value = base;
+    }
+    else
+    {
+        value.clear();
+        value.reserve(size);
+        value.insert(value.end(), base.begin(), base.begin() + prefix);
+        value.resize(size - suffix);
+        value.insert(value.end(), base.end() - suffix, base.end());
+    }
+
+    size_t offset = prefix;
+    size_t end = size - suffix;
+    while(count-- > 0)
+    {
+        size_t skip;
+        size_t length;
+        if(!readSize(delta, pos, skip) || skip > end - offset ||
+           !readSize(delta, pos, length) || length > end - offset - skip || length > delta.size() - pos)
+        {
+            return false;
+        }
+        offset += skip;
+        copy(delta.begin() + pos, delta.begin() + pos + length, value.begin() + offset);
+        pos += length;
+        offset += length;
+    }
+    return pos == delta.size();
+}
+
+}
+
+shared_ptr<Tag>
+DataStormI::getDeltaTag()
+{
+    static const shared_ptr<Tag> tag = make_shared<DeltaTag>();
+    return tag;
+}
+
+bool
+DataStormI::applyDelta(const shared_ptr<Sample>& previous,
+                       const shared_ptr<Sample>& next,
+                       const shared_ptr<Ice::Communicator>& communicator)
+{
+    //
+    // The previous sample must be the sample the delta was computed from. It might not be if the reader
+    // didn't receive all the samples of the writer or if it also receives samples from other writers.
+    //
+    const auto& delta = next->getEncodedValue();
+    size_t pos = 0;
+    size_t baseId;
+    if(!readSize(delta, pos, baseId) || !previous || previous->event == DataStorm::SampleEvent::Remove ||
+       previous->session != next->session || previous->origin != next->origin ||
+       previous->id != (baseId > 0 ? static_cast<long long int>(baseId) : next->id - 1))
+    {
+        return false;
+    }
+
+    vector<unsigned char> value;
+    if(!applyDeltaValue(previous->encodeValue(communicator), delta, pos, value))
+    {
+        return false;
+    }
+    next->setEncodedValue(move(value));
+    next->decode(communicator);
+    next->event = DataStorm::SampleEvent::Update;
+    next->tag = nullptr;
+    return true;
+}
+
+vector<unsigned char>
+DataStormI::computeDelta(long long int baseId, const vector<unsigned char>& base, const vector<unsigned char>& value)
+{
+    //
+    // The delta is composed of a header with the base sample id, the base value size and hash,
+    // the new value size and the size of the prefix and suffix shared with the base value. It's
+    // followed by the segments of bytes which differ from the base value.
+    //
+    size_t max = min(base.size(), value.size());
+    size_t prefix = 0;
+    while(prefix < max && base[prefix] == value[prefix])
+    {
+        ++prefix;
+    }
+    size_t suffix = 0;
+    while(suffix < max - prefix && base[base.size() - suffix - 1] == value[value.size() - suffix - 1])
+    {
+        ++suffix;
+    }
+
+    vector<pair<size_t, size_t>> segments;
+    size_t begin = prefix;
+    size_t end = value.size() - suffix;
+    if(base.size() == value.size())
+    {
+        // Same size values, only send the bytes which differ.
+        size_t i = begin;
+        while(i < end)
+        {
+            if(base[i] == value[i])
+            {
+                ++i;
+                continue;
+            }
+            size_t first = i;
+            size_t last = i;
+            while(i < end && i - last <= segmentGap)
+            {
+                if(base[i] != value[i])
+                {
+                    last = i;
+                }
+                ++i;
+            }
+            segments.emplace_back(first, last + 1);
+            i = last + 1;
+        }
+    }
+    else if(begin < end)
+    {
+        segments.emplace_back(begin, end);
+    }
+
+    vector<unsigned char> delta;
+    writeSize(delta, static_cast<size_t>(baseId));
+    writeSize(delta, base.size());
+    writeHash(delta, hashValue(base));
+    writeSize(delta, value.size());
+    writeSize(delta, prefix);
+    writeSize(delta, suffix);
+    writeSize(delta, segments.size());
+    size_t pos = begin;
+    for(const auto& s : segments)
+    {
+        writeSize(delta, s.first - pos);
+        writeSize(delta, s.second - s.first);
+        delta.insert(delta.end(), value.begin() + s.first, value.begin() + s.second);
+        pos = s.second;
+    }
+    return delta;
+}
+
@@ -0,0 +1,38 @@
+//
+// Copyright (c) ZeroC, Inc. All rights reserved.
+//
+#pragma once
+
+#include <DataStorm/InternalI.h>
+
+namespace DataStormI
+{
+
+//
+// Delta encoded samples are sent as partial updates with this reserved tag id. Tag ids allocated
+// by the tag factory are always positive.
+//
+const long long int DeltaTagId = -1;
+
+//
+// The tag of delta encoded samples. Readers decode these samples by applying the delta to the
+// encoded value of the sample the delta was computed from.
+//
+std::shared_ptr<Tag> getDeltaTag();
+
+//
+// Compute the delta to transform the given base encoded value into the given encoded value. The
+// delta carries the id of the base sample or 0 if the base sample id immediately precedes the id
+// of the delta sample (the base sample is published with the same batch).
+//
+std::vector<unsigned char> computeDelta(long long int, const std::vector<unsigned char>&,
+                                        const std::vector<unsigned char>&);
+
+//
+// Decode the value of the given delta sample from the given previous sample. Returns false if the
+// previous sample isn't the sample the delta was computed from, the delta sample is left unchanged.
+//
+bool applyDelta(const std::shared_ptr<Sample>&, const std::shared_ptr<Sample>&,
+                const std::shared_ptr<Ice::Communicator>&);
+
+}
@@ -0,0 +1,410 @@
+//
+// Copyright (c) ZeroC, Inc. All rights reserved.
+//
+#include <DataStorm/FlowControl.h>
+#include <DataStorm/Compression.h>
+
+#include <Ice/Ice.h>
+
+#include <algorithm>
+#include <atomic>
+
+using namespace std;
+using namespace DataStormI;
+using namespace DataStormContract;
+
+DataSample
+DataStormI::foldSample(const shared_ptr<Sample>& sample,
+                       const DataSample& data,
+                       const DataSample* pending,
+                       bool compressed,
+                       const shared_ptr<Ice::Communicator>& communicator)
+{
+    DataSample folded = data;
+    if(folded.event == DataStorm::SampleEvent::PartialUpdate)
+    {
+        //
+        // The writer sample holds the value computed by the topic updater for the partial update
+        // or the full value for a delta encoded sample. The value is sent with an update since the
+        // listener might not get the sample the partial update applies to.
+        //
+        folded.event = DataStorm::SampleEvent::Update;
+        folded.tag = 0;
+        folded.value = sample->event == DataStorm::SampleEvent::PartialUpdate ?
+            sample->encodeValue(communicator) : sample->encode(communicator);
+        if(compressed)
+        {
+            folded.value = compressValue(DataStorm::Compression::None, 0, folded.value);
+        }
+    }
+
+    // An add not sent yet is replaced by an add with the new value.
+    if(pending && pending->event == DataStorm::SampleEvent::Add && folded.event == DataStorm::SampleEvent::Update)
+    {
+        folded.event = DataStorm::SampleEvent::Add;
+    }
+    return folded;
+}
+
+FlowControl::FlowControl(size_t highWaterMark,
+                         size_t highWaterMarkBytes,
+                         DataStorm::OverflowPolicy policy,
+                         function<void(const string&, bool)> notify,
+                         const shared_ptr<Ice::Communicator>& communicator,
+                         const shared_ptr<Timer>& timer) :
+    _highWaterMark(highWaterMark),
+    _highWaterMarkBytes(highWaterMarkBytes),
+    _policy(policy),
+    _notify(move(notify)),
+    _communicator(communicator),
+    _timer(timer),
+    _overflowCount(0),
+    _destroyed(false)
+{
+}
+
+shared_ptr<FlowControl::Listener>
+FlowControl::createListener(const string& session, const shared_ptr<DataStormContract::SessionPrx>& proxy,
+                            bool compressed)
+{
+    return make_shared<Listener>(session, proxy, compressed);
+}
+
+void
+FlowControl::send(const shared_ptr<Listener>& listener, size_t size, Request request, RequestSamples samples)
+{
+    bool overflow = false;
+    bool disconnect = false;
+    {
+        lock_guard<mutex> lock(_mutex);
+        if(_destroyed)
+        {
+            return;
+        }
+
+        if(_policy == DataStorm::OverflowPolicy::DropOldest &&
+           (listener->overflow || listener->draining || !listener->queue.empty()))
+        {
+            //
+            // Queue the request until the listener is back below the high-water mark, the oldest
+            // requests are dropped if the queue exceeds the high-water mark.
+            //
+            listener->queue.push_back({ size, move(request), move(samples) });
+            listener->queueBytes += size;
+            if(!isQueueFull(listener->queue.size(), listener->queueBytes) || dropOldest(*listener))
+            {
+                return;
+            }
+
+            //
+            // The queue can't be brought back below the high-water mark without dropping samples
+            // other than updates, the queued requests are discarded and the connection is closed.
+            //
+            listener->queue.clear();
+            listener->queueBytes = 0;
+            disconnect = true;
+        }
+        else
+        {
+            overflow = acquire(*listener, size);
+        }
+    }
+
+    if(disconnect)
+    {
+        close(listener);
+        return;
+    }
+
+    if(overflow)
+    {
+        overflowed(listener);
+    }
+    invoke(listener, size, move(request));
+}
+
+bool
+FlowControl::conflate(const shared_ptr<Listener>& listener,
+                      const vector<pair<shared_ptr<Sample>, const DataSample*>>& samples,
+                      const BatchRequest& batch)
+{
+    lock_guard<mutex> lock(_mutex);
+    if(_destroyed)
+    {
+        return true;
+    }
+
+    //
+    // Samples are sent with a regular request until the listener reaches the high-water mark. Once
+    // it's reached, the samples are conflated until the pending requests are sent.
+    //
+    if(!listener->overflow && !listener->draining && listener->conflated.empty())
+    {
+        return false;
+    }
+
+    if(!listener->batch)
+    {
+        listener->batch = batch;
+    }
+    for(const auto& s : samples)
+    {
+        auto p = listener->conflatedKeys.find(s.first->key);
+        if(p == listener->conflatedKeys.end())
+        {
+            listener->conflatedKeys.emplace(s.first->key, listener->conflated.size());
+            listener->conflated.push_back(foldSample(s.first, *s.second, nullptr, listener->compressed, _communicator));
+        }
+        else
+        {
+            auto& pending = listener->conflated[p->second];
+            pending = foldSample(s.first, *s.second, &pending, listener->compressed, _communicator);
+        }
+    }
+    return true;
+}
+
+bool
+FlowControl::hasOverflow()
+{
+    lock_guard<mutex> lock(_mutex);
+    return _overflowCount > 0;
+}
+
+void
+FlowControl::wait(const vector<shared_ptr<Listener>>& listeners)
+{
+    //
+    // Wait for the given listeners to be back below the high-water mark, the other listeners which
+    // reached the high-water mark don't block the caller.
+    //
+    unique_lock<mutex> lock(_mutex);
+    _cond.wait(lock, [this, &listeners]
+    {
+        return _destroyed ||
+            none_of(listeners.begin(), listeners.end(), [](const shared_ptr<Listener>& l) { return l->overflow; });
+    });
+}
+
+void
+FlowControl::destroy()
+{
+    lock_guard<mutex> lock(_mutex);
+    _destroyed = true;
+    _cond.notify_all();
+}
+
+bool
+FlowControl::acquire(Listener& listener, size_t size)
+{
+    // Called with the mutex locked, returns true if the listener reached the high-water mark.
+    ++listener.requests;
+    listener.bytes += size;
+    if(!listener.overflow && isFull(listener.requests, listener.bytes))
+    {
+        listener.overflow = true;
+        ++_overflowCount;
+        return true;
+    }
+    return false;
+}
+
+void
+FlowControl::invoke(const shared_ptr<Listener>& listener, size_t size, Request request)
+{
+    //
+    // The request completion callback is called both when the request is sent and if it fails,
+    // make sure it's only accounted once.
+    //
+    auto self = shared_from_this();
+    auto completed = make_shared<atomic<bool>>(false);
+    request([self, listener, size, completed]
+    {
+        if(!completed->exchange(true))
+        {
+            self->completed(listener, size);
+        }
+    });
+}
+
+void
+FlowControl::completed(const shared_ptr<Listener>& listener, size_t size)
+{
+    bool resumed = false;
+    {
+        lock_guard<mutex> lock(_mutex);
+        --listener->requests;
+        listener->bytes -= size;
+        if(listener->overflow && !isFull(listener->requests, listener->bytes))
+        {
+            listener->overflow = false;
+            --_overflowCount;
+            _cond.notify_all();
+            resumed = true;
+        }
+    }
+
+    if(resumed)
+    {
+        _notify(listener->session, false);
+    }
+    if(_policy == DataStorm::OverflowPolicy::DropOldest || _policy == DataStorm::OverflowPolicy::Conflate)
+    {
+        drain(listener);
+    }
+}
+
+void
+FlowControl::overflowed(const shared_ptr<Listener>& listener)
+{
+    _notify(listener->session, true);
+    if(_policy == DataStorm::OverflowPolicy::Disconnect)
+    {
+        close(listener);
+    }
+}
+
+void
+FlowControl::close(const shared_ptr<Listener>& listener)
+{
+    //
+    // Close the connection with the listener, this discards the requests queued for sending to the
+    // listener. The session will be re-established by the listener node. The caller might hold the
+    // topic mutex, the connection is closed from the timer thread.
+    //
+    auto proxy = listener->proxy;
+    _timer->schedule(chrono::milliseconds(0), [proxy]
+    {
+        auto connection = proxy->ice_getCachedConnection();
+        if(connection)
+        {
+            connection->close(Ice::ConnectionClose::Forcefully);
+        }
+    });
+}
+
+void
+FlowControl::drain(const shared_ptr<Listener>& listener)
+{
+    //
+    // Send the queued requests in order until the listener reaches the high-water mark again. The
+    // draining flag ensures only one thread sends the queued requests, requests sent while the queue
+    // is being drained are queued to preserve ordering. The conflated samples are sent with a single
+    // batch request.
+    //
+    unique_lock<mutex> lock(_mutex);
+    if(listener->draining)
+    {
+        return;
+    }
+    listener->draining = true;
+    while(!_destroyed && !listener->overflow)
+    {
+        pair<size_t, Request> request;
+        if(!listener->queue.empty())
+        {
+            request.first = listener->queue.front().size;
+            request.second = move(listener->queue.front().request);
+            listener->queue.pop_front();
+            listener->queueBytes -= request.first;
+        }
+        else if(!listener->conflated.empty())
+        {
+            DataSampleSeq samples;
+            samples.swap(listener->conflated);
+            listener->conflatedKeys.clear();
+            request.first = 0;
+            for(const auto& sample : samples)
+            {
+                request.first += sample.value.size();
+            }
+            request.second = listener->batch(move(samples));
+        }
+        else
+        {
+            break;
+        }
+        bool overflow = acquire(*listener, request.first);
+        lock.unlock();
+        if(overflow)
+        {
+            overflowed(listener);
+        }
+        invoke(listener, request.first, move(request.second));
+        lock.lock();
+    }
+    listener->draining = false;
+}
+
+bool
+FlowControl::dropOldest(Listener& listener)
+{
+    //
+    // Called with the mutex locked, returns false if the queue still exceeds the high-water mark. A queued
+    // request can only be dropped if all its samples are full updates and if the next queued sample of each
+    // key, if any, is also a full update. The listener would otherwise apply a partial update to a value it
+    // didn't receive. The requests are visited from the newest to the oldest to find the next sample of each
+    // key. The oldest requests superseded by a newer full update are dropped first, then the oldest requests
+    // with the last queued update of a key.
+    //
+    vector<bool> superseded(listener.queue.size());
+    vector<bool> droppable(listener.queue.size());
+    map<shared_ptr<Key>, bool> next;
+    for(size_t i = listener.queue.size(); i-- > 0;)
+    {
+        const auto& samples = listener.queue[i].samples;
+        superseded[i] = !samples.empty() && all_of(samples.begin(), samples.end(),
+            [&next](const pair<shared_ptr<Key>, bool>& s)
+            {
+                auto p = next.find(s.first);
+                return s.second && p != next.end() && p->second;
+            });
+        droppable[i] = !samples.empty() && all_of(samples.begin(), samples.end(),
+            [&next](const pair<shared_ptr<Key>, bool>& s)
+            {
+                auto p = next.find(s.first);
+                return s.second && (p == next.end() || p->second);
+            });
+        for(auto p = samples.rbegin(); p != samples.rend(); ++p)
+        {
+            next[p->first] = p->second;
+        }
+    }
+
+    //
+    // Mark the requests to drop before erasing them, the indexes of the requests are the queue
+    // positions computed above.
+    //
+    vector<bool> dropped(listener.queue.size());
+    size_t size = listener.queue.size();
+    size_t bytes = listener.queueBytes;
+    auto drop = [&](const vector<bool>& candidates)
+    {
+        for(size_t i = 0; i < candidates.size() && isQueueFull(size, bytes); ++i)
+        {
+            if(candidates[i] && !dropped[i])
+            {
+                dropped[i] = true;
+                --size;
+                bytes -= listener.queue[i].size;
+            }
+        }
+    };
+    drop(superseded);
+    drop(droppable);
+
+    size_t i = 0;
+    for(auto p = listener.queue.begin(); p != listener.queue.end(); ++i)
+    {
+        if(dropped[i])
+        {
+            listener.queueBytes -= p->size;
+            p = listener.queue.erase(p);
+        }
+        else
+        {
+            ++p;
+        }
+    }
+    return !isQueueFull(listener.queue.size(), listener.queueBytes);
+}
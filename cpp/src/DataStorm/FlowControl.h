@@ -0,0 +1,149 @@
+//
+// Copyright (c) ZeroC, Inc. All rights reserved.
+//
+#pragma once
+
+#include <DataStorm/Config.h>
+#include <DataStorm/Types.h>
+#include <DataStorm/InternalI.h>
+#include <DataStorm/Contract.h>
+#include <DataStorm/Timer.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace DataStormI
+{
+
+//
+// Returns the sample to send in place of the given sample data when intermediate samples are not
+// sent to a listener. Partial updates are replaced by an update with the sample value and if the
+// pending sample replaced by this sample is an add, the sample is sent as an add. The value of the
+// update is prefixed with the compression byte if the listener gets compressed values.
+//
+DataStormContract::DataSample foldSample(const std::shared_ptr<Sample>&,
+                                         const DataStormContract::DataSample&,
+                                         const DataStormContract::DataSample*,
+                                         bool,
+                                         const std::shared_ptr<Ice::Communicator>&);
+
+//
+// The flow control of a writer bounds the number and size of the sample requests queued by Ice for
+// sending to each listener of the writer. A request is queued until it's sent or until it fails.
+// When a listener reaches the high-water mark, the overflow policy is applied: publishing blocks
+// until the requests of the listeners the samples are sent to are sent, the requests are queued by
+// the flow control and the oldest ones are dropped, the listener connection is closed, or
+// the samples are queued by the flow control and conflated by key.
+//
+class FlowControl : public std::enable_shared_from_this<FlowControl>
+{
+public:
+
+    //
+    // A request is sent with a callback which must be called once the request is sent or failed.
+    //
+    using Request = std::function<void(std::function<void()>)>;
+
+    //
+    // Creates the request to send a batch of conflated samples to a listener.
+    //
+    using BatchRequest = std::function<Request(DataStormContract::DataSampleSeq)>;
+
+    //
+    // The key of each sample of a request and whether or not the sample is a full update. The drop
+    // oldest policy only drops requests whose samples are all full updates.
+    //
+    using RequestSamples = std::vector<std::pair<std::shared_ptr<Key>, bool>>;
+
+    struct QueuedRequest
+    {
+        size_t size;
+        Request request;
+        RequestSamples samples;
+    };
+
+    struct Listener
+    {
+        Listener(const std::string& session, const std::shared_ptr<DataStormContract::SessionPrx>& proxy,
+                 bool compressed) :
+            session(session), proxy(proxy), compressed(compressed), requests(0), bytes(0), overflow(false),
+            draining(false), queueBytes(0)
+        {
+        }
+
+        const std::string session;
+        const std::shared_ptr<DataStormContract::SessionPrx> proxy;
+        const bool compressed;
+
+        size_t requests;
+        size_t bytes;
+        bool overflow;
+        bool draining;
+        std::deque<QueuedRequest> queue;
+        size_t queueBytes;
+
+        // The conflated samples and the index of the conflated sample of each key.
+        DataStormContract::DataSampleSeq conflated;
+        std::map<std::shared_ptr<Key>, size_t> conflatedKeys;
+        BatchRequest batch;
+    };
+
+    FlowControl(size_t, size_t, DataStorm::OverflowPolicy, std::function<void(const std::string&, bool)>,
+                const std::shared_ptr<Ice::Communicator>&, const std::shared_ptr<Timer>&);
+
+    std::shared_ptr<Listener> createListener(const std::string&, const std::shared_ptr<DataStormContract::SessionPrx>&,
+                                             bool);
+
+    void send(const std::shared_ptr<Listener>&, size_t, Request, RequestSamples);
+    bool conflate(const std::shared_ptr<Listener>&,
+                  const std::vector<std::pair<std::shared_ptr<Sample>, const DataStormContract::DataSample*>>&,
+                  const BatchRequest&);
+    bool hasOverflow();
+    void wait(const std::vector<std::shared_ptr<Listener>>&);
+    void destroy();
+
+    DataStorm::OverflowPolicy getPolicy() const
+    {
+        return _policy;
+    }
+
+private:
+
+    bool acquire(Listener&, size_t);
+    void invoke(const std::shared_ptr<Listener>&, size_t, Request);
+    void completed(const std::shared_ptr<Listener>&, size_t);
+    void overflowed(const std::shared_ptr<Listener>&);
+    void close(const std::shared_ptr<Listener>&);
+    void drain(const std::shared_ptr<Listener>&);
+    bool dropOldest(Listener&);
+
+    bool isFull(size_t requests, size_t bytes) const
+    {
+        return (_highWaterMark > 0 && requests >= _highWaterMark) ||
+               (_highWaterMarkBytes > 0 && bytes >= _highWaterMarkBytes);
+    }
+
+    bool isQueueFull(size_t size, size_t bytes) const
+    {
+        return (_highWaterMark > 0 && size > _highWaterMark) ||
+               (_highWaterMarkBytes > 0 && bytes > _highWaterMarkBytes);
+    }
+
+    const size_t _highWaterMark;
+    const size_t _highWaterMarkBytes;
+    const DataStorm::OverflowPolicy _policy;
+    const std::function<void(const std::string&, bool)> _notify;
+    const std::shared_ptr<Ice::Communicator> _communicator;
+    const std::shared_ptr<Timer> _timer;
+
+    std::mutex _mutex;
+    std::condition_variable _cond;
+    size_t _overflowCount;
+    bool _destroyed;
+};
+
+}
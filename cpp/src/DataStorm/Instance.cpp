@@ -38,6 +38,14 @@ Instance::Instance(const shared_ptr<Ice::Communicator>& communicator) : _communi
             }
         }
 
+        //
+        // The server thread pool size can be increased with the DataStorm.Node.Server.ThreadPool.Size and
+        // SizeMax properties to dispatch the requests from different connections in parallel. Requests from
+        // a connection are always dispatched in order: the sessions rely on the ordering of the requests
+        // from the peer node.
+        //
+        properties->setProperty("DataStorm.Node.Adapters.Server.ThreadPool.Serialize", "1");
+
         try
         {
             _adapter = _communicator->createObjectAdapter("DataStorm.Node.Adapters.Server");
@@ -101,10 +109,16 @@ Instance::Instance(const shared_ptr<Ice::Communicator>& communicator) : _communi
     _collocatedForwarder = make_shared<ForwarderManager>(_collocatedAdapter, "forwarders");
     _collocatedAdapter->addDefaultServant(_collocatedForwarder, "forwarders");
 
-    _executor = make_shared<CallbackExecutor>();
+    _traceLevels = make_shared<TraceLevels>(_communicator);
+
+    //
+    // The user callbacks are run by the callback thread pool, callbacks for the same reader or writer are
+    // never run concurrently.
+    //
+    auto callbackThreads = properties->getPropertyAsIntWithDefault("DataStorm.Node.CallbackThreadPool.Size", 1);
+    _executor = make_shared<CallbackExecutor>(static_cast<size_t>(max(callbackThreads, 1)), _traceLevels);
     _connectionManager = make_shared<ConnectionManager>(_executor);
     _timer = make_shared<Timer>();
-    _traceLevels = make_shared<TraceLevels>(_communicator);
 }
 
 void
@@ -10,7 +10,8 @@ $(project)_generated_includedir := $(project)/generated/DataStorm
 
 DataStorm_sliceflags    := -I$(ice_slicedir) --include-dir DataStorm -I$(slicedir)
 DataStorm_targetdir     := $(libdir)
-DataStorm_cppflags      := -DDATASTORM_API_EXPORTS -DICE_CPP11_MAPPING
+DataStorm_cppflags      := -DDATASTORM_API_EXPORTS -DICE_CPP11_MAPPING -DDATASTORM_HAS_ZLIB
 DataStorm_dependencies  := Ice++11
+DataStorm_system_libs   := -lz
 
 projects += $(project)
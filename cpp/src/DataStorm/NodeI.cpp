@@ -30,6 +30,11 @@ public:
 
     virtual bool dispatch(Ice::Request& req) override
     {
+        //
+        // Requests for different sessions can be dispatched concurrently if the server thread pool has
+        // more than one thread. The requests from a connection are serialized by the thread pool and
+        // the session servant synchronizes with its own mutex before locking the topics.
+        //
         auto session = _node->getSession(req.getCurrent().id);
         if(!session)
         {
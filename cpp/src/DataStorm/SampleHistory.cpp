@@ -0,0 +1,244 @@
+//
+// Copyright (c) ZeroC, Inc. All rights reserved.
+//
+#include <algorithm>
+#include <assert.h>
+
+#include <DataStorm/SampleHistory.h>
+
+using namespace std;
+using namespace DataStormI;
+
+namespace
+{
+
+const size_t minBufferSize = 16;
+
+}
+
+SampleHistory::SampleHistory(size_t capacity) :
+    _capacity(capacity),
+    _head(0),
+    _size(0),
+    _ordered(true),
+    _keyIndex(false)
+{
+}
+
+void
+SampleHistory::push_back(const shared_ptr<Sample>& sample)
+{
+    if(_size > 0 && sample->timestamp < back()->timestamp)
+    {
+        _ordered = false;
+    }
+    if(_capacity > 0 && _size == _capacity)
+    {
+        pop_front();
+    }
+    if(_size == _buffer.size())
+    {
+        grow();
+    }
+    at(_size) = sample;
+    ++_size;
+    if(_keyIndex)
+    {
+        _keySamples[sample->key].push_back(sample);
+    }
+}
+
+void
+SampleHistory::pop_front()
+{
+    assert(_size > 0);
+    if(_keyIndex)
+    {
+        popFromKeyIndex(front());
+    }
+    at(0) = nullptr;
+    _head = (_head + 1) % _buffer.size();
+    if(--_size == 0)
+    {
+        _head = 0;
+        _ordered = true;
+    }
+}
+
+void
+SampleHistory::take(size_t count, vector<shared_ptr<Sample>>& samples)
+{
+    //
+    // Move the given number of samples from the front of the history to the end of the given
+    // vector. The samples are moved out of the buffer rather than copied.
+    //
+    count = min(count, _size);
+    if(count == 0)
+    {
+        return;
+    }
+    samples.reserve(samples.size() + count);
+    for(size_t i = 0; i < count; ++i)
+    {
+        if(_keyIndex)
+        {
+            popFromKeyIndex(at(i));
+        }
+        samples.push_back(move(at(i)));
+    }
+    _head = (_head + count) % _buffer.size();
+    _size -= count;
+    if(_size == 0)
+    {
+        _head = 0;
+        _ordered = true;
+    }
+}
+
+void
+SampleHistory::clear()
+{
+    for(size_t i = 0; i < _size; ++i)
+    {
+        at(i) = nullptr;
+    }
+    _head = 0;
+    _size = 0;
+    _ordered = true;
+    _keySamples.clear();
+}
+
+void
+SampleHistory::expire(const chrono::time_point<chrono::system_clock>& staleTime)
+{
+    if(_ordered)
+    {
+        while(_size > 0 && front()->timestamp < staleTime)
+        {
+            pop_front();
+        }
+        return;
+    }
+
+    //
+    // The samples aren't ordered by timestamp (this can occur with readers receiving samples from
+    // writers with different clocks), remove the stale samples from the whole history.
+    //
+    size_t count = 0;
+    bool ordered = true;
+    for(size_t i = 0; i < _size; ++i)
+    {
+        if(at(i)->timestamp < staleTime)
+        {
+            if(_keyIndex)
+            {
+                removeFromKeyIndex(at(i));
+            }
+            continue;
+        }
+        if(count > 0 && at(i)->timestamp < at(count - 1)->timestamp)
+        {
+            ordered = false;
+        }
+        if(count != i)
+        {
+            at(count) = move(at(i));
+        }
+        ++count;
+    }
+    for(size_t i = count; i < _size; ++i)
+    {
+        at(i) = nullptr;
+    }
+    _size = count;
+    _ordered = ordered;
+    if(_size == 0)
+    {
+        _head = 0;
+    }
+}
+
+chrono::time_point<chrono::system_clock>
+SampleHistory::getOldestTimestamp() const
+{
+    assert(_size > 0);
+    if(_ordered)
+    {
+        return front()->timestamp;
+    }
+
+    auto oldest = front()->timestamp;
+    for(size_t i = 1; i < _size; ++i)
+    {
+        oldest = min(oldest, at(i)->timestamp);
+    }
+    return oldest;
+}
+
+void
+SampleHistory::grow()
+{
+    size_t size = max(minBufferSize, _buffer.size() * 2);
+    if(_capacity > 0)
+    {
+        size = min(size, _capacity);
+    }
+    assert(size > _size);
+
+    vector<shared_ptr<Sample>> buffer(size);
+    for(size_t i = 0; i < _size; ++i)
+    {
+        buffer[i] = move(at(i));
+    }
+    _buffer.swap(buffer);
+    _head = 0;
+}
+
+void
+SampleHistory::enableKeyIndex()
+{
+    assert(_size == 0);
+    _keyIndex = true;
+}
+
+const deque<shared_ptr<Sample>>*
+SampleHistory::getKeySamples(const shared_ptr<Key>& key) const
+{
+    assert(_keyIndex);
+    auto p = _keySamples.find(key);
+    return p != _keySamples.end() ? &p->second : nullptr;
+}
+
+void
+SampleHistory::popFromKeyIndex(const shared_ptr<Sample>& sample)
+{
+    //
+    // The front sample is the oldest sample of the history, it's also the oldest sample of its
+    // key.
+    //
+    auto p = _keySamples.find(sample->key);
+    assert(p != _keySamples.end() && p->second.front() == sample);
+    p->second.pop_front();
+    if(p->second.empty())
+    {
+        _keySamples.erase(p);
+    }
+}
+
+void
+SampleHistory::removeFromKeyIndex(const shared_ptr<Sample>& sample)
+{
+    auto p = _keySamples.find(sample->key);
+    if(p != _keySamples.end())
+    {
+        auto q = find(p->second.begin(), p->second.end(), sample);
+        if(q != p->second.end())
+        {
+            p->second.erase(q);
+        }
+        if(p->second.empty())
+        {
+            _keySamples.erase(p);
+        }
+    }
+}
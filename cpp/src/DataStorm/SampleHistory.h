@@ -0,0 +1,183 @@
+//
+// Copyright (c) ZeroC, Inc. All rights reserved.
+//
+#pragma once
+
+#include <DataStorm/InternalI.h>
+
+#include <vector>
+#include <deque>
+#include <map>
+#include <iterator>
+
+namespace DataStormI
+{
+
+//
+// The sample history of a data element. The samples are stored in a ring buffer which is bounded
+// if the element is configured with a sample count. Since sample timestamps are most of the time
+// monotonic, expiring samples only requires trimming the front of the history.
+//
+// The history can optionally index the samples by key to allow retrieving the samples of a given
+// key without scanning the whole history.
+//
+class SampleHistory
+{
+public:
+
+    class const_iterator
+    {
+    public:
+
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = std::shared_ptr<Sample>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::shared_ptr<Sample>*;
+        using reference = const std::shared_ptr<Sample>&;
+
+        const_iterator() : _history(nullptr), _pos(0)
+        {
+        }
+
+        const_iterator(const SampleHistory* history, size_t pos) : _history(history), _pos(pos)
+        {
+        }
+
+        reference operator*() const
+        {
+            return _history->at(_pos);
+        }
+
+        pointer operator->() const
+        {
+            return &_history->at(_pos);
+        }
+
+        const_iterator& operator++()
+        {
+            ++_pos;
+            return *this;
+        }
+
+        const_iterator operator++(int)
+        {
+            auto tmp = *this;
+            ++_pos;
+            return tmp;
+        }
+
+        const_iterator& operator--()
+        {
+            --_pos;
+            return *this;
+        }
+
+        const_iterator operator--(int)
+        {
+            auto tmp = *this;
+            --_pos;
+            return tmp;
+        }
+
+        bool operator==(const const_iterator& other) const
+        {
+            return _pos == other._pos;
+        }
+
+        bool operator!=(const const_iterator& other) const
+        {
+            return _pos != other._pos;
+        }
+
+    private:
+
+        const SampleHistory* _history;
+        size_t _pos;
+    };
+
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    SampleHistory(size_t = 0);
+
+    bool empty() const
+    {
+        return _size == 0;
+    }
+
+    size_t size() const
+    {
+        return _size;
+    }
+
+    const std::shared_ptr<Sample>& front() const
+    {
+        return at(0);
+    }
+
+    const std::shared_ptr<Sample>& back() const
+    {
+        return at(_size - 1);
+    }
+
+    const_iterator begin() const
+    {
+        return const_iterator(this, 0);
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(this, _size);
+    }
+
+    const_reverse_iterator rbegin() const
+    {
+        return const_reverse_iterator(end());
+    }
+
+    const_reverse_iterator rend() const
+    {
+        return const_reverse_iterator(begin());
+    }
+
+    void push_back(const std::shared_ptr<Sample>&);
+    void pop_front();
+    void take(size_t, std::vector<std::shared_ptr<Sample>>&);
+    void clear();
+    void expire(const std::chrono::time_point<std::chrono::system_clock>&);
+    std::chrono::time_point<std::chrono::system_clock> getOldestTimestamp() const;
+
+    void enableKeyIndex();
+
+    bool hasKeyIndex() const
+    {
+        return _keyIndex;
+    }
+
+    const std::deque<std::shared_ptr<Sample>>* getKeySamples(const std::shared_ptr<Key>&) const;
+
+private:
+
+    const std::shared_ptr<Sample>& at(size_t pos) const
+    {
+        return _buffer[(_head + pos) % _buffer.size()];
+    }
+
+    std::shared_ptr<Sample>& at(size_t pos)
+    {
+        return _buffer[(_head + pos) % _buffer.size()];
+    }
+
+    void grow();
+    void popFromKeyIndex(const std::shared_ptr<Sample>&);
+    void removeFromKeyIndex(const std::shared_ptr<Sample>&);
+
+    const size_t _capacity;
+    std::vector<std::shared_ptr<Sample>> _buffer;
+    size_t _head;
+    size_t _size;
+    bool _ordered;
+    bool _keyIndex;
+    std::map<std::shared_ptr<Key>, std::deque<std::shared_ptr<Sample>>> _keySamples;
+};
+
+}
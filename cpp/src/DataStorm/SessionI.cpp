@@ -17,6 +17,7 @@
 #include <DataStorm/TraceUtil.h>
 #include <DataStorm/CallbackExecutor.h>
 #include <DataStorm/Timer.h>
+#include <DataStorm/Compression.h>
 
 using namespace std;
 using namespace DataStormI;
@@ -468,7 +469,7 @@ SessionI::initSamples(long long int topicId, DataSamplesSeq samplesSeq, const Ic
                                                              s.id,
                                                              s.event,
                                                              key,
-                                                             subscriber.tags[s.tag],
+                                                             subscriber.getTag(s.tag),
                                                              s.value,
                                                              s.timestamp));
                 }
@@ -1086,7 +1087,7 @@ SessionI::subscriberInitialized(long long int topicId,
                                                  s.id,
                                                  s.event,
                                                  key ? key : keyFactory->decode(_instance->getCommunicator(), s.keyValue),
-                                                 subscriber.tags[s.tag],
+                                                 subscriber.getTag(s.tag),
                                                  s.value,
                                                  s.timestamp));
         assert(samplesI.back()->key);
@@ -1182,6 +1183,13 @@ SessionI::runWithTopic(long long int id, TopicI* topic, function<void (TopicSubs
 SubscriberSessionI::SubscriberSessionI(const std::shared_ptr<NodeI>& parent, const shared_ptr<NodePrx>& node) :
     SessionI(parent, node)
 {
+    //
+    // A decompressed sample value can't be larger than the largest message accepted by the communicator. The
+    // Ice.MessageSizeMax property is in kilobytes, a value of 0 or less means no limit.
+    //
+    auto properties = _instance->getCommunicator()->getProperties();
+    auto messageSizeMax = properties->getPropertyAsIntWithDefault("Ice.MessageSizeMax", 1024);
+    _maxValueSize = messageSizeMax > 0 ? static_cast<size_t>(messageSizeMax) * 1024 : 0;
 }
 
 vector<shared_ptr<TopicI>>
@@ -1193,84 +1201,168 @@ SubscriberSessionI::getTopics(const string& name) const
 void
 SubscriberSessionI::s(long long int topicId, long long int elementId, DataSample s, const Ice::Current& current)
 {
+    // Decompress the value before locking, the session and topic mutexes aren't held while decompressing.
+    if(current.ctx.find(compressionContext) != current.ctx.end() && !decompress(topicId, elementId, s))
+    {
+        return;
+    }
+
     lock_guard<mutex> lock(_mutex);
-    if(!_session || current.con != _connection)
+    if(!acceptSamples(topicId, elementId, s.id, current))
     {
-        if(current.con != _connection)
+        return;
+    }
+    auto now = chrono::system_clock::now();
+    runWithTopics(topicId, [&](TopicI* topic, TopicSubscriber& subscriber, TopicSubscribers&)
+    {
+        auto e = subscriber.get(elementId);
+        if(e && !e->getSubscribers().empty())
         {
-            Trace out(_traceLevels, _traceLevels->sessionCat);
-            out << _id << ": discarding sample `" << s.id << "' from `e" << elementId << '@' << topicId << "'\n";
-            if(_connection)
+            queue(topic, subscriber, e, topicId, elementId, s, now, current);
+        }
+    });
+}
+
+void
+SubscriberSessionI::ss(long long int topicId, long long int elementId, DataSampleSeq samples,
+                       const Ice::Current& current)
+{
+    // Decompress the values before locking, a sample which can't be decompressed is discarded.
+    if(current.ctx.find(compressionContext) != current.ctx.end())
+    {
+        for(auto p = samples.begin(); p != samples.end();)
+        {
+            if(decompress(topicId, elementId, *p))
             {
-                out << current.con->toString() << "\n" << _connection->toString();
+                ++p;
             }
             else
             {
-                out << "<not connected>";
+                p = samples.erase(p);
             }
         }
+    }
+
+    lock_guard<mutex> lock(_mutex);
+    if(samples.empty() || !acceptSamples(topicId, elementId, samples.front().id, current))
+    {
         return;
     }
     auto now = chrono::system_clock::now();
-    runWithTopics(topicId, [&](TopicI* topic, TopicSubscriber& subscriber, TopicSubscribers& topicSubscribers)
+    runWithTopics(topicId, [&](TopicI* topic, TopicSubscriber& subscriber, TopicSubscribers&)
     {
         auto e = subscriber.get(elementId);
         if(e && !e->getSubscribers().empty())
         {
-            if(_traceLevels->session > 2)
+            for(const auto& s : samples)
             {
-                Trace out(_traceLevels, _traceLevels->sessionCat);
-                out << _id << ": queuing sample `" << s.id << "[k" << s.keyId << "]' from `e" << elementId << '@' << topicId << "'";
-                if(!current.facet.empty())
-                {
-                    out << " facet=" << current.facet;
-                }
-                out << " to [";
-                for(auto q = e->getSubscribers().begin(); q != e->getSubscribers().end(); ++q)
-                {
-                    if(q != e->getSubscribers().begin())
-                    {
-                        out << ", ";
-                    }
-                    out << q->first;
-                    if(!q->second.facet.empty())
-                    {
-                        out << ":" << q->second.facet;
-                    }
-                }
-                out << "]";
+                queue(topic, subscriber, e, topicId, elementId, s, now, current);
             }
+        }
+    });
+}
 
-            shared_ptr<Key> key;
-            if(s.keyValue.empty())
+bool
+SubscriberSessionI::acceptSamples(long long int topicId, long long int elementId, long long int sampleId,
+                                  const Ice::Current& current) const
+{
+    if(!_session || current.con != _connection)
+    {
+        if(current.con != _connection)
+        {
+            Trace out(_traceLevels, _traceLevels->sessionCat);
+            out << _id << ": discarding sample `" << sampleId << "' from `e" << elementId << '@' << topicId << "'\n";
+            if(_connection)
             {
-                key = subscriber.keys[s.keyId].first;
+                out << current.con->toString() << "\n" << _connection->toString();
             }
             else
             {
-                key = topic->getKeyFactory()->decode(_instance->getCommunicator(), s.keyValue);
+                out << "<not connected>";
+            }
+        }
+        return false;
+    }
+    return true;
+}
+
+bool
+SubscriberSessionI::decompress(long long int topicId, long long int elementId, DataSample& s) const
+{
+    try
+    {
+        s.value = decompressValue(s.value, _maxValueSize);
+        return true;
+    }
+    catch(const Ice::MarshalException& ex)
+    {
+        Trace out(_traceLevels, _traceLevels->sessionCat);
+        out << _id << ": discarding sample `" << s.id << "' from `e" << elementId << '@' << topicId << "'\n" << ex.what();
+        return false;
+    }
+}
+
+void
+SubscriberSessionI::queue(TopicI* topic,
+                          TopicSubscriber& subscriber,
+                          ElementSubscribers* e,
+                          long long int topicId,
+                          long long int elementId,
+                          const DataSample& s,
+                          const chrono::time_point<chrono::system_clock>& now,
+                          const Ice::Current& current)
+{
+    if(_traceLevels->session > 2)
+    {
+        Trace out(_traceLevels, _traceLevels->sessionCat);
+        out << _id << ": queuing sample `" << s.id << "[k" << s.keyId << "]' from `e" << elementId << '@' << topicId << "'";
+        if(!current.facet.empty())
+        {
+            out << " facet=" << current.facet;
+        }
+        out << " to [";
+        for(auto q = e->getSubscribers().begin(); q != e->getSubscribers().end(); ++q)
+        {
+            if(q != e->getSubscribers().begin())
+            {
+                out << ", ";
             }
-            assert(key);
-
-            auto impl = topic->getSampleFactory()->create(_id,
-                                                          e->name,
-
-                                                          s.id,
-                                                          s.event,
-                                                          key,
-                                                          subscriber.tags[s.tag],
-                                                          s.value,
-                                                          s.timestamp);
-            for(auto& es : e->getSubscribers())
+            out << q->first;
+            if(!q->second.facet.empty())
             {
-                if(es.second.initialized && (s.keyId <= 0 || es.second.keys.find(key) != es.second.keys.end()))
-                {
-                    es.second.lastId = s.id;
-                    es.first->queue(impl, e->priority, shared_from_this(), current.facet, now, !s.keyValue.empty());
-                }
+                out << ":" << q->second.facet;
             }
         }
-    });
+        out << "]";
+    }
+
+    shared_ptr<Key> key;
+    if(s.keyValue.empty())
+    {
+        key = subscriber.keys[s.keyId].first;
+    }
+    else
+    {
+        key = topic->getKeyFactory()->decode(_instance->getCommunicator(), s.keyValue);
+    }
+    assert(key);
+
+    auto impl = topic->getSampleFactory()->create(_id,
+                                                  e->name,
+                                                  s.id,
+                                                  s.event,
+                                                  key,
+                                                  subscriber.getTag(s.tag),
+                                                  s.value,
+                                                  s.timestamp);
+    for(auto& es : e->getSubscribers())
+    {
+        if(es.second.initialized && (s.keyId <= 0 || es.second.keys.find(key) != es.second.keys.end()))
+        {
+            es.second.lastId = s.id;
+            es.first->queue(impl, e->priority, shared_from_this(), current.facet, now, !s.keyValue.empty());
+        }
+    }
 }
 
 void
@@ -5,6 +5,7 @@
 
 #include <DataStorm/NodeI.h>
 #include <DataStorm/Contract.h>
+#include <DataStorm/Delta.h>
 
 #include <Ice/Ice.h>
 
@@ -182,6 +183,12 @@ protected:
             }
         }
 
+        std::shared_ptr<Tag>
+        getTag(long long int id)
+        {
+            return id == DeltaTagId ? getDeltaTag() : tags[id];
+        }
+
         std::map<long long int, std::pair<std::shared_ptr<Key>, std::map<long long int, int>>> keys;
         std::map<long long int, std::shared_ptr<Tag>> tags;
         int sessionInstanceId;
@@ -372,12 +379,22 @@ public:
     SubscriberSessionI(const std::shared_ptr<NodeI>&, const std::shared_ptr<DataStormContract::NodePrx>&);
 
     virtual void s(long long int, long long int, DataStormContract::DataSample, const Ice::Current&) override;
+    virtual void ss(long long int, long long int, DataStormContract::DataSampleSeq, const Ice::Current&) override;
 
 private:
 
+    bool acceptSamples(long long int, long long int, long long int, const Ice::Current&) const;
+    bool decompress(long long int, long long int, DataStormContract::DataSample&) const;
+    void queue(TopicI*, TopicSubscriber&, ElementSubscribers*, long long int, long long int,
+               const DataStormContract::DataSample&, const std::chrono::time_point<std::chrono::system_clock>&,
+               const Ice::Current&);
+
     virtual std::vector<std::shared_ptr<TopicI>> getTopics(const std::string&) const override;
     virtual void reconnect(const std::shared_ptr<DataStormContract::NodePrx>&) override;
     virtual void remove() override;
+
+    // The maximum size of a decompressed sample value, 0 for no maximum.
+    size_t _maxValueSize;
 };
 
 class PublisherSessionI : public SessionI, public DataStormContract::PublisherSession
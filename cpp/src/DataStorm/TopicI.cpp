@@ -6,6 +6,7 @@
 #include <DataStorm/SessionI.h>
 #include <DataStorm/NodeI.h>
 #include <DataStorm/TraceUtil.h>
+#include <DataStorm/Timer.h>
 
 using namespace std;
 using namespace DataStormI;
@@ -71,11 +72,86 @@ public:
     {
         return true;
     }
+
+    virtual bool getPrefix(string&) const
+    {
+        return false;
+    }
 };
 const auto alwaysMatchFilter = make_shared<AlwaysMatchFilter>();
 
 }
 
+void
+PrefixIndex::add(const string& prefix, const shared_ptr<Filter>& filter)
+{
+    Node* node = &_root;
+    for(auto c : prefix)
+    {
+        auto& child = node->children[c];
+        if(!child)
+        {
+            child.reset(new Node());
+        }
+        node = child.get();
+    }
+    node->filters.push_back(filter);
+}
+
+void
+PrefixIndex::remove(const string& prefix, const shared_ptr<Filter>& filter)
+{
+    vector<Node*> path;
+    path.reserve(prefix.size() + 1);
+    path.push_back(&_root);
+    for(auto c : prefix)
+    {
+        auto p = path.back()->children.find(c);
+        if(p == path.back()->children.end())
+        {
+            return;
+        }
+        path.push_back(p->second.get());
+    }
+
+    auto& filters = path.back()->filters;
+    filters.erase(std::remove(filters.begin(), filters.end(), filter), filters.end());
+
+    // Remove the nodes left without filters and children
+    for(size_t i = prefix.size(); i > 0; --i)
+    {
+        if(!path[i]->filters.empty() || !path[i]->children.empty())
+        {
+            break;
+        }
+        path[i - 1]->children.erase(prefix[i - 1]);
+    }
+}
+
+void
+PrefixIndex::match(const string& value, vector<shared_ptr<Filter>>& filters) const
+{
+    const Node* node = &_root;
+    filters.insert(filters.end(), node->filters.begin(), node->filters.end());
+    for(auto c : value)
+    {
+        auto p = node->children.find(c);
+        if(p == node->children.end())
+        {
+            break;
+        }
+        node = p->second.get();
+        filters.insert(filters.end(), node->filters.begin(), node->filters.end());
+    }
+}
+
+void
+PrefixIndex::clear()
+{
+    _root.children.clear();
+    _root.filters.clear();
+}
+
 TopicI::TopicI(const weak_ptr<TopicFactoryI>& factory,
                const shared_ptr<KeyFactory>& keyFactory,
                const shared_ptr<TagFactory>& tagFactory,
@@ -100,7 +176,8 @@ TopicI::TopicI(const weak_ptr<TopicFactoryI>& factory,
     _notified(0),
     _nextId(0),
     _nextFilteredId(0),
-    _nextSampleId(0)
+    _nextSampleId(0),
+    _expiryTime(chrono::time_point<chrono::system_clock>::max())
 {
 }
 
@@ -141,7 +218,14 @@ TopicI::destroy()
         }
         _keyElements.swap(keyElements);
         _filteredElements.swap(filteredElements);
+        _prefixFilters.clear();
+        _unindexedFilters.clear();
         _instance->getCollocatedForwarder()->remove(_forwarder->ice_getIdentity());
+        if(_expiryCanceller)
+        {
+            _expiryCanceller();
+            _expiryCanceller = nullptr;
+        }
     }
     disconnect();
 }
@@ -151,6 +235,85 @@ TopicI::shutdown()
 {
     lock_guard<mutex> lock(_mutex);
     _cond.notify_all();
+    for(const auto& k : _keyElements)
+    {
+        for(const auto& e : k.second)
+        {
+            e->shutdown();
+        }
+    }
+    for(const auto& f : _filteredElements)
+    {
+        for(const auto& e : f.second)
+        {
+            e->shutdown();
+        }
+    }
+}
+
+void
+TopicI::scheduleExpiry(const chrono::time_point<chrono::system_clock>& expiryTime)
+{
+    // Called with the mutex locked, nothing to do if the expiry is already scheduled earlier.
+    if(_destroyed || expiryTime >= _expiryTime)
+    {
+        return;
+    }
+
+    if(_expiryCanceller)
+    {
+        _expiryCanceller();
+    }
+    _expiryTime = expiryTime;
+    auto delay = chrono::duration_cast<chrono::milliseconds>(expiryTime - chrono::system_clock::now());
+    delay = max(delay + chrono::milliseconds(1), chrono::milliseconds(0));
+    weak_ptr<TopicI> self = shared_from_this();
+    _expiryCanceller = _instance->getTimer()->schedule(delay, [self]
+    {
+        auto topic = self.lock();
+        if(topic)
+        {
+            topic->expireSamples();
+        }
+    });
+}
+
+void
+TopicI::expireSamples()
+{
+    lock_guard<mutex> lock(_mutex);
+    _expiryTime = chrono::time_point<chrono::system_clock>::max();
+    _expiryCanceller = nullptr;
+    if(_destroyed)
+    {
+        return;
+    }
+
+    //
+    // Expire the samples of all the topic elements and schedule the next expiry for the oldest sample
+    // left. An element with multiple keys is expired once for each key, expiring an already expired
+    // sample history is cheap.
+    //
+    auto now = chrono::system_clock::now();
+    auto expiryTime = chrono::time_point<chrono::system_clock>::max();
+    for(const auto& k : _keyElements)
+    {
+        for(const auto& e : k.second)
+        {
+            expiryTime = min(expiryTime, e->expireSamples(now));
+        }
+    }
+    for(const auto& f : _filteredElements)
+    {
+        for(const auto& e : f.second)
+        {
+            expiryTime = min(expiryTime, e->expireSamples(now));
+        }
+    }
+    if(expiryTime != chrono::time_point<chrono::system_clock>::max())
+    {
+        scheduleExpiry(expiryTime);
+    }
 }
 
 TopicSpec
@@ -203,22 +366,38 @@ TopicI::getElementSpecs(long long int topicId, const ElementInfoSeq& infos, cons
                 }
                 specs.push_back({ move(elements), key->getId(), "", {}, info.id });
             }
-            for(auto e : _filteredElements)
+
+            //
+            // The prefix filters matching the key are looked up in the prefix index, the other
+            // filters are evaluated.
+            //
+            vector<shared_ptr<Filter>> filters;
+            if(!_prefixFilters.empty())
             {
-                if(e.first->match(key))
+                _prefixFilters.match(key->toPrefixString(), filters);
+            }
+            for(const auto& f : _unindexedFilters)
+            {
+                if(f->match(key))
                 {
-                    ElementDataSeq elements;
-                    for(auto f : e.second)
-                    {
-                        elements.push_back({ f->getId(), f->getConfig(), session->getLastIds(topicId, info.id, f) });
-                    }
-                    specs.push_back({ move(elements),
-                                      -e.first->getId(),
-                                      e.first->getName(),
-                                      e.first->encode(_instance->getCommunicator()),
-                                      info.id });
+                    filters.push_back(f);
                 }
             }
+            for(const auto& filter : filters)
+            {
+                auto p = _filteredElements.find(filter);
+                assert(p != _filteredElements.end());
+                ElementDataSeq elements;
+                for(auto f : p->second)
+                {
+                    elements.push_back({ f->getId(), f->getConfig(), session->getLastIds(topicId, info.id, f) });
+                }
+                specs.push_back({ move(elements),
+                                  -filter->getId(),
+                                  filter->getName(),
+                                  filter->encode(_instance->getCommunicator()),
+                                  info.id });
+            }
         }
         else
         {
@@ -652,6 +831,15 @@ TopicI::removeFiltered(const shared_ptr<DataElementI>& element, const shared_ptr
         p->second.erase(element);
         if(p->second.empty())
         {
+            string prefix;
+            if(filter->getPrefix(prefix))
+            {
+                _prefixFilters.remove(prefix, filter);
+            }
+            else
+            {
+                _unindexedFilters.erase(filter);
+            }
             _filteredElements.erase(p);
         }
     }
@@ -813,6 +1001,15 @@ TopicI::addFiltered(const shared_ptr<DataElementI>& element, const shared_ptr<Fi
     if(p == _filteredElements.end())
     {
         p = _filteredElements.emplace(filter, set<shared_ptr<DataElementI>>()).first;
+        string prefix;
+        if(filter->getPrefix(prefix))
+        {
+            _prefixFilters.add(prefix, filter);
+        }
+        else
+        {
+            _unindexedFilters.insert(filter);
+        }
     }
     assert(element);
     p->second.insert(element);
@@ -880,6 +1077,7 @@ TopicReaderI::TopicReaderI(const shared_ptr<TopicFactoryI>& factory,
 {
     _defaultConfig = { -1, 0, DataStorm::ClearHistoryPolicy::OnAll, DataStorm::DiscardPolicy::None };
     _defaultConfig = mergeConfigs(parseConfig("DataStorm.Topic"));
+    _defaultConfig = mergeConfigs(parseConfig("DataStorm.Topic." + name));
 }
 
 shared_ptr<DataReader>
@@ -965,6 +1163,21 @@ TopicReaderI::parseConfig(const string& prefix) const
             config.discardPolicy = DataStorm::DiscardPolicy::Priority;
         }
     }
+    p = properties.find(prefix + ".MinSampleInterval");
+    if(p != properties.end())
+    {
+        config.minSampleInterval = toInt(p->second);
+    }
+    p = properties.find(prefix + ".LazyDecode");
+    if(p != properties.end())
+    {
+        config.lazyDecode = toInt(p->second) > 0;
+    }
+    p = properties.find(prefix + ".LastValueCache");
+    if(p != properties.end())
+    {
+        config.lastValueCache = toInt(p->second) > 0;
+    }
     return config;
 }
 
@@ -987,6 +1200,18 @@ TopicReaderI::mergeConfigs(DataStorm::ReaderConfig config) const
     {
         config.discardPolicy = _defaultConfig.discardPolicy;
     }
+    if(!config.minSampleInterval && _defaultConfig.minSampleInterval)
+    {
+        config.minSampleInterval = _defaultConfig.minSampleInterval;
+    }
+    if(!config.lazyDecode && _defaultConfig.lazyDecode)
+    {
+        config.lazyDecode = _defaultConfig.lazyDecode;
+    }
+    if(!config.lastValueCache && _defaultConfig.lastValueCache)
+    {
+        config.lastValueCache = _defaultConfig.lastValueCache;
+    }
     return config;
 }
 
@@ -1002,6 +1227,7 @@ TopicWriterI::TopicWriterI(const shared_ptr<TopicFactoryI>& factory,
 {
     _defaultConfig = { -1, 0, DataStorm::ClearHistoryPolicy::OnAll };
     _defaultConfig = mergeConfigs(parseConfig("DataStorm.Topic"));
+    _defaultConfig = mergeConfigs(parseConfig("DataStorm.Topic." + name));
 }
 
 shared_ptr<DataWriter>
@@ -1061,6 +1287,68 @@ TopicWriterI::parseConfig(const string& prefix) const
         is >> priority;
         config.priority = priority;
     }
+    p = properties.find(prefix + ".FlushInterval");
+    if(p != properties.end())
+    {
+        config.flushInterval = toInt(p->second);
+    }
+    p = properties.find(prefix + ".FlushSize");
+    if(p != properties.end())
+    {
+        config.flushSize = toInt(p->second);
+    }
+    p = properties.find(prefix + ".DeltaKeyFrameInterval");
+    if(p != properties.end())
+    {
+        config.deltaKeyFrameInterval = toInt(p->second);
+    }
+    p = properties.find(prefix + ".Compression");
+    if(p != properties.end())
+    {
+        if(p->second == "None")
+        {
+            config.compression = DataStorm::Compression::None;
+        }
+        else if(p->second == "Zlib")
+        {
+            config.compression = DataStorm::Compression::Zlib;
+        }
+    }
+    p = properties.find(prefix + ".CompressionThreshold");
+    if(p != properties.end())
+    {
+        config.compressionThreshold = toInt(p->second);
+    }
+    p = properties.find(prefix + ".HighWaterMark");
+    if(p != properties.end())
+    {
+        config.highWaterMark = toInt(p->second);
+    }
+    p = properties.find(prefix + ".HighWaterMarkBytes");
+    if(p != properties.end())
+    {
+        config.highWaterMarkBytes = toInt(p->second);
+    }
+    p = properties.find(prefix + ".OverflowPolicy");
+    if(p != properties.end())
+    {
+        if(p->second == "Block")
+        {
+            config.overflowPolicy = DataStorm::OverflowPolicy::Block;
+        }
+        else if(p->second == "DropOldest")
+        {
+            config.overflowPolicy = DataStorm::OverflowPolicy::DropOldest;
+        }
+        else if(p->second == "Disconnect")
+        {
+            config.overflowPolicy = DataStorm::OverflowPolicy::Disconnect;
+        }
+        else if(p->second == "Conflate")
+        {
+            config.overflowPolicy = DataStorm::OverflowPolicy::Conflate;
+        }
+    }
     return config;
 }
 
@@ -1083,5 +1371,37 @@ TopicWriterI::mergeConfigs(DataStorm::WriterConfig config) const
     {
         config.priority = _defaultConfig.priority;
     }
+    if(!config.flushInterval && _defaultConfig.flushInterval)
+    {
+        config.flushInterval = _defaultConfig.flushInterval;
+    }
+    if(!config.flushSize && _defaultConfig.flushSize)
+    {
+        config.flushSize = _defaultConfig.flushSize;
+    }
+    if(!config.deltaKeyFrameInterval && _defaultConfig.deltaKeyFrameInterval)
+    {
+        config.deltaKeyFrameInterval = _defaultConfig.deltaKeyFrameInterval;
+    }
+    if(!config.compression && _defaultConfig.compression)
+    {
+        config.compression = _defaultConfig.compression;
+    }
+    if(!config.compressionThreshold && _defaultConfig.compressionThreshold)
+    {
+        config.compressionThreshold = _defaultConfig.compressionThreshold;
+    }
+    if(!config.highWaterMark && _defaultConfig.highWaterMark)
+    {
+        config.highWaterMark = _defaultConfig.highWaterMark;
+    }
+    if(!config.highWaterMarkBytes && _defaultConfig.highWaterMarkBytes)
+    {
+        config.highWaterMarkBytes = _defaultConfig.highWaterMarkBytes;
+    }
+    if(!config.overflowPolicy && _defaultConfig.overflowPolicy)
+    {
+        config.overflowPolicy = _defaultConfig.overflowPolicy;
+    }
     return config;
 }
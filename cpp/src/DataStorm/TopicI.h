@@ -15,6 +15,36 @@ namespace DataStormI
 class SessionI;
 class TopicFactoryI;
 
+//
+// The prefix index is a trie of the built-in `_prefix' key filters of the topic filtered elements.
+// The filters matching a key are found in time proportional to the key length rather than by
+// evaluating each filter.
+//
+class PrefixIndex
+{
+public:
+
+    void add(const std::string&, const std::shared_ptr<Filter>&);
+    void remove(const std::string&, const std::shared_ptr<Filter>&);
+    void match(const std::string&, std::vector<std::shared_ptr<Filter>>&) const;
+    void clear();
+
+    bool empty() const
+    {
+        return _root.children.empty() && _root.filters.empty();
+    }
+
+private:
+
+    struct Node
+    {
+        std::map<char, std::unique_ptr<Node>> children;
+        std::vector<std::shared_ptr<Filter>> filters;
+    };
+
+    Node _root;
+};
+
 class TopicI : virtual public Topic, public std::enable_shared_from_this<TopicI>
 {
     struct ListenerKey
@@ -145,6 +175,9 @@ protected:
     void add(const std::shared_ptr<DataElementI>&, const std::vector<std::shared_ptr<Key>>&);
     void addFiltered(const std::shared_ptr<DataElementI>&, const std::shared_ptr<Filter>&);
 
+    void scheduleExpiry(const std::chrono::time_point<std::chrono::system_clock>&);
+    void expireSamples();
+
     void parseConfigImpl(const Ice::PropertyDict&, const std::string&, DataStorm::Config&) const;
 
     friend class DataElementI;
@@ -171,6 +204,13 @@ protected:
     bool _destroyed;
     std::map<std::shared_ptr<Key>, std::set<std::shared_ptr<DataElementI>>> _keyElements;
     std::map<std::shared_ptr<Filter>, std::set<std::shared_ptr<DataElementI>>> _filteredElements;
+
+    //
+    // The filters of the filtered elements, the prefix filters are indexed and the other filters are
+    // evaluated for each key.
+    //
+    PrefixIndex _prefixFilters;
+    std::set<std::shared_ptr<Filter>> _unindexedFilters;
     std::map<ListenerKey, Listener> _listeners;
     std::map<std::shared_ptr<Tag>, Updater> _updaters;
     size_t _listenerCount;
@@ -179,6 +219,13 @@ protected:
     long long int _nextId;
     long long int _nextFilteredId;
     long long int _nextSampleId;
+
+    //
+    // The samples of the topic elements with a sample lifetime are expired by a single timer task
+    // scheduled for the earliest sample expiry time.
+    //
+    std::chrono::time_point<std::chrono::system_clock> _expiryTime;
+    std::function<void()> _expiryCanceller;
 };
 
 class TopicReaderI : public TopicReader, public TopicI
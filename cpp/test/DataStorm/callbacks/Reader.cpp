@@ -372,5 +372,43 @@ main(int argc, char* argv[])
 
         readers.update(3);
     }
+
+    // Callback ordering
+    {
+        Topic<string, int> ordering(node, "ordering");
+        vector<SingleKeyReader<string, int>> orderingReaders;
+        vector<int> expected(4, 1);
+        vector<promise<void>> done(4);
+        for(int i = 0; i < 4; ++i)
+        {
+            orderingReaders.push_back(makeSingleKeyReader(ordering, "elem" + to_string(i), "", config));
+        }
+        for(int i = 0; i < 4; ++i)
+        {
+            auto check = [&expected, &done, i](int value)
+            {
+                test(value == expected[i]);
+                if(++expected[i] > 100)
+                {
+                    done[i].set_value();
+                }
+            };
+            orderingReaders[i].onSamples([check](const vector<Sample<string, int>>& samples)
+            {
+                for(const auto& sample : samples)
+                {
+                    check(sample.getValue());
+                }
+            }, [check](const Sample<string, int>& sample)
+            {
+                check(sample.getValue());
+            });
+        }
+        for(auto& p : done)
+        {
+            p.get_future().wait();
+        }
+        readers.update(1);
+    }
     return 0;
 }
@@ -249,5 +249,25 @@ main(int argc, char* argv[])
     }
     cout << "ok" << endl;
 
+    cout << "testing callback ordering... " << flush;
+    {
+        //
+        // The reader callbacks run with a thread pool when DataStorm.Node.CallbackThreadPool.Size is
+        // set, the callbacks of each reader must still be called in order.
+        //
+        Topic<string, int> ordering(node, "ordering");
+        auto writer = makeMultiKeyWriter(ordering, { "elem0", "elem1", "elem2", "elem3" }, "", config);
+        writer.waitForReaders(4);
+        for(int i = 1; i <= 100; ++i)
+        {
+            for(int j = 0; j < 4; ++j)
+            {
+                writer.update("elem" + to_string(j), i);
+            }
+        }
+        test(readers.getNextUnread().getValue() == 1);
+    }
+    cout << "ok" << endl;
+
     return 0;
 }
@@ -10,4 +10,14 @@ traceProps = {
     "DataStorm.Trace.Data" : 3
 }
 
-TestSuite(__file__, [ ClientServerTestCase(traceProps=traceProps) ])
+threadPoolProps = {
+    "DataStorm.Node.CallbackThreadPool.Size" : 4
+}
+
+TestSuite(__file__, [
+    ClientServerTestCase(traceProps=traceProps),
+    ClientServerTestCase(name="client/server with callback thread pool",
+                         client=Writer(props=threadPoolProps),
+                         server=Reader(props=threadPoolProps),
+                         traceProps=traceProps)
+])
@@ -97,6 +97,17 @@ main(int argc, char* argv[])
     cout << "ok" << endl;
 
     cout << "testing writer sampleLifetime... " << flush;
+    {
+        // Expired samples are removed from the history of an idle writer
+        WriterConfig config;
+        config.sampleLifetime = 20;
+        config.clearHistory = ClearHistoryPolicy::Never;
+        auto writer = makeSingleKeyWriter(topic, "elem2", "", config);
+        writer.add("value1");
+        writer.remove();
+        this_thread::sleep_for(chrono::milliseconds(200));
+        test(writer.getAll().empty());
+    }
     {
         writers.update(false); // Not ready
 
@@ -249,6 +249,13 @@ main(int argc, char* argv[])
             test(reader.hasWriters());
             reader.getNextUnread();
         }
+        {
+            auto reader = makeFilteredKeyReader(topic, Filter<string>("_prefix", "site/rack1/"), "", config);
+            reader.waitForWriters(1);
+            auto sample = reader.getNextUnread();
+            test(sample.getKey() == "site/rack1/device1");
+            test(sample.getValue()->b == "value1");
+        }
     }
 
     {
@@ -387,5 +394,294 @@ main(int argc, char* argv[])
         }
      }
 
+    {
+        Topic<string, string> topic(node, "batch");
+
+        auto reader1 = makeSingleKeyReader(topic, "elem1", "", config);
+        auto reader2 = makeSingleKeyReader(topic, "elem2", "", config);
+
+        reader1.waitForUnread(2);
+        auto samples = reader1.getAllUnread();
+        test(samples.size() == 2);
+        test(samples[0].getEvent() == SampleEvent::Update && samples[0].getValue() == "value1");
+        test(samples[1].getEvent() == SampleEvent::Update && samples[1].getValue() == "value2");
+
+        reader2.waitForUnread(1);
+        auto sample = reader2.getNextUnread();
+        test(sample.getKey() == "elem2" && sample.getValue() == "value1");
+    }
+
+    {
+        Topic<string, string> topic(node, "keyhandle");
+
+        auto reader = makeSingleKeyReader(topic, "elem1", "", config);
+
+        reader.waitForUnread(3);
+        auto samples = reader.getAllUnread();
+        test(samples.size() == 3);
+        test(samples[0].getEvent() == SampleEvent::Add && samples[0].getValue() == "value1");
+        test(samples[1].getEvent() == SampleEvent::Update && samples[1].getValue() == "value2");
+        test(samples[2].getEvent() == SampleEvent::Remove);
+    }
+
+    {
+        Topic<string, string> topic(node, "coalesce");
+
+        auto reader = makeSingleKeyReader(topic, "elem1", "", config);
+
+        reader.waitForUnread(4);
+        auto samples = reader.getAllUnread();
+        test(samples.size() == 4);
+        for(size_t i = 0; i < samples.size(); ++i)
+        {
+            test(samples[i].getValue() == "value" + to_string(i + 1));
+        }
+    }
+
+    {
+        Topic<string, string> topic(node, "delta");
+
+        auto reader = makeSingleKeyReader(topic, "elem1", "", config);
+
+        // The reader with a sample filter doesn't get the add sample, it gets the deltas as full updates.
+        auto filteredReader = makeSingleKeyReader(topic, "elem1",
+                                                  Filter<SampleEventSeq>("_event",
+                                                                         SampleEventSeq { SampleEvent::Update }),
+                                                  "", config);
+
+        reader.waitForUnread(8);
+        auto samples = reader.getAllUnread();
+        test(samples.size() == 8);
+        string value(256, 'a');
+        test(samples[0].getEvent() == SampleEvent::Add && samples[0].getValue() == value);
+        for(int i = 0; i < 5; ++i)
+        {
+            value[i * 50] = 'b';
+            test(samples[i + 1].getEvent() == SampleEvent::Update && samples[i + 1].getValue() == value);
+        }
+        test(samples[6].getEvent() == SampleEvent::Update && samples[6].getValue() == "short");
+        test(samples[7].getEvent() == SampleEvent::Remove);
+
+        filteredReader.waitForUnread(6);
+        samples = filteredReader.getAllUnread();
+        test(samples.size() == 6);
+        value = string(256, 'a');
+        for(int i = 0; i < 5; ++i)
+        {
+            value[i * 50] = 'b';
+            test(samples[i].getEvent() == SampleEvent::Update && samples[i].getValue() == value);
+        }
+        test(samples[5].getEvent() == SampleEvent::Update && samples[5].getValue() == "short");
+    }
+
+    {
+        Topic<string, string> topic(node, "compression");
+
+        auto reader = makeSingleKeyReader(topic, "elem1", "", config);
+
+        reader.waitForUnread(4);
+        auto samples = reader.getAllUnread();
+        test(samples.size() == 4);
+        string value;
+        for(int i = 0; i < 100; ++i)
+        {
+            value += "value" + to_string(i % 10);
+        }
+        test(samples[0].getEvent() == SampleEvent::Add && samples[0].getValue() == value);
+        test(samples[1].getEvent() == SampleEvent::Update && samples[1].getValue() == "short");
+        test(samples[2].getEvent() == SampleEvent::Update && samples[2].getValue() == value + value);
+        test(samples[3].getEvent() == SampleEvent::Remove);
+    }
+
+    {
+        Topic<string, string> topic(node, "flowcontrol");
+
+        auto reader = makeSingleKeyReader(topic, "elem1", "", config);
+
+        reader.waitForUnread(21);
+        auto samples = reader.getAllUnread();
+        test(samples.size() == 21);
+        for(int i = 0; i < 20; ++i)
+        {
+            test(samples[i].getValue() == "value" + to_string(i));
+        }
+        test(samples[20].getEvent() == SampleEvent::Remove);
+    }
+
+    {
+        Topic<string, string> topic(node, "conflation");
+        topic.setUpdater<string>("concat", [](string& value, string update) { value += update; });
+
+        auto reader = makeAnyKeyReader(topic, "", config);
+
+        //
+        // Intermediate samples might be conflated, the readers always get the latest value of each
+        // key and partial updates are applied to the value.
+        //
+        map<string, string> values;
+        int removed = 0;
+        while(removed < 2)
+        {
+            auto sample = reader.getNextUnread();
+            if(sample.getEvent() == SampleEvent::Remove)
+            {
+                ++removed;
+                continue;
+            }
+            auto value = sample.getValue();
+            test(value.compare(0, 5, "value") == 0);
+            test(sample.getEvent() != SampleEvent::PartialUpdate || value.back() == 'x');
+            values[sample.getKey()] = value;
+        }
+        test(values["elem1"] == "value49x");
+        test(values["elem2"] == "value49x");
+    }
+
+    {
+        Topic<string, string> topic(node, "ratelimit");
+
+        ReaderConfig rateLimitConfig = config;
+        rateLimitConfig.minSampleInterval = 200;
+        auto reader = makeSingleKeyReader(topic, "elem1", "", rateLimitConfig);
+
+        // The writer skips the updates published within the interval but always sends the latest one.
+        auto sample = reader.getNextUnread();
+        test(sample.getEvent() == SampleEvent::Add && sample.getValue() == "value0");
+        int count = 1;
+        while(sample.getValue() != "value99")
+        {
+            sample = reader.getNextUnread();
+            test(sample.getEvent() == SampleEvent::Update);
+            ++count;
+        }
+        test(count < 100);
+    }
+
+    {
+        Topic<string, string> topic(node, "lazydecode");
+        topic.setUpdater<string>("concat", [](string& value, string update) { value += update; });
+
+        ReaderConfig lazyConfig = config;
+        lazyConfig.lazyDecode = true;
+        auto reader = makeSingleKeyReader(topic, "elem1", "", lazyConfig);
+
+        reader.waitForUnread(53);
+        auto samples = reader.getAllUnread();
+        test(samples.size() == 53);
+
+        // Decode the values in reverse order, the partial updates are applied on demand.
+        string expected = "value";
+        for(int i = 0; i < 50; ++i)
+        {
+            expected += to_string(i % 10);
+        }
+        for(int i = 50; i > 0; --i)
+        {
+            test(samples[i].getEvent() == SampleEvent::PartialUpdate);
+            test(samples[i].getValue() == expected);
+            expected.pop_back();
+        }
+        test(samples[0].getEvent() == SampleEvent::Add && samples[0].getValue() == "value");
+        test(samples[51].getEvent() == SampleEvent::Update && samples[51].getValue() == "value");
+        test(samples[52].getEvent() == SampleEvent::Remove);
+    }
+
+    {
+        Topic<string, string> topic(node, "samplebatch");
+        auto reader = makeSingleKeyReader(topic, "elem1", "", config);
+
+        mutex m;
+        int count = 0;
+        int batches = 0;
+        promise<void> p;
+        reader.onSampleBatch([&](const vector<Sample<string, string>>& samples)
+        {
+            lock_guard<mutex> lock(m);
+            test(!samples.empty());
+            for(const auto& sample : samples)
+            {
+                test(sample.getValue() == "value" + to_string(count++));
+            }
+            ++batches;
+            if(count == 100)
+            {
+                p.set_value();
+            }
+        });
+        p.get_future().wait();
+        lock_guard<mutex> lock(m);
+        test(batches <= 100);
+    }
+
+    {
+        Topic<string, string> topic(node, "drain");
+        auto reader1 = makeSingleKeyReader(topic, "elem1", "", config);
+        auto reader2 = makeSingleKeyReader(topic, "elem1", "", config);
+        auto reader3 = makeSingleKeyReader(topic, "elem1", "", config);
+
+        reader1.waitForUnread(10);
+        auto samples = reader1.take(3);
+        test(samples.size() == 3);
+        test(samples[0].getEvent() == SampleEvent::Add && samples[2].getValue() == "value2");
+        samples = reader1.take(100);
+        test(samples.size() == 7 && samples[0].getValue() == "value3" && samples[6].getValue() == "value9");
+        test(reader1.take(1).empty() && !reader1.hasUnread());
+
+        reader2.waitForUnread(10);
+        deque<Sample<string, string>> unread;
+        reader2.drainInto(unread);
+        reader2.drainInto(unread);
+        test(unread.size() == 10 && unread.back().getValue() == "value9");
+
+        reader3.waitForUnread(10);
+        int count = 0;
+        test(reader3.forEachUnread([&count](const Sample<string, string>& sample)
+        {
+            test(sample.getValue() == "value" + to_string(count++));
+        }) == 10);
+        test(count == 10 && !reader3.hasUnread());
+    }
+
+    {
+        Topic<string, string> topic(node, "lastvalue");
+        ReaderConfig lastValueConfig = config;
+        lastValueConfig.lastValueCache = true;
+        auto reader = makeAnyKeyReader(topic, "", lastValueConfig);
+
+        reader.waitForUnread(17);
+        for(const auto& key : { "elem0", "elem1", "elem2" })
+        {
+            test(reader.getLast(key).getValue() == "value3");
+        }
+        try
+        {
+            reader.getLast("elem3");
+            test(false);
+        }
+        catch(const std::logic_error&)
+        {
+        }
+        auto last = reader.getAllLast();
+        test(last.size() == 3);
+        for(const auto& sample : last)
+        {
+            test(sample.getKey() != "elem3" && sample.getValue() == "value3");
+        }
+    }
+
+    {
+        Topic<string, string> topic(node, "concurrent");
+
+        auto reader = makeAnyKeyReader(topic, "", config);
+
+        reader.waitForUnread(400);
+        map<string, int> next;
+        for(const auto& sample : reader.getAllUnread())
+        {
+            test(sample.getValue() == "value" + to_string(next[sample.getKey()]++));
+        }
+        test(next.size() == 4);
+    }
+
     return 0;
 }
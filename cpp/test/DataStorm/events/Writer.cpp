@@ -6,6 +6,8 @@
 #include <Test.h>
 #include <TestCommon.h>
 
+#include <thread>
+
 using namespace DataStorm;
 using namespace std;
 
@@ -277,6 +279,15 @@ main(int argc, char* argv[])
             writer2.remove();
             writer2.waitForNoReaders();
         }
+        {
+            auto writer1 = makeSingleKeyWriter(topic, "site/rack2/device1", "", config);
+            auto writer2 = makeSingleKeyWriter(topic, "site/rack1/device1", "", config);
+            test(!writer1.hasReaders());
+            writer2.waitForReaders(1);
+            test(!writer1.hasReaders());
+            writer2.add(make_shared<Test::Base>("value1"));
+            writer2.waitForNoReaders();
+        }
     }
     cout << "ok" << endl;
 
@@ -367,6 +378,271 @@ main(int argc, char* argv[])
     }
     cout << "ok" << endl;
 
+    cout << "testing batched updates... " << flush;
+    {
+        Topic<string, string> topic(node, "batch");
+        auto writer = makeAnyKeyWriter(topic, "", config);
+        writer.waitForReaders(2);
+
+        writer.update({ { "elem1", "value1" }, { "elem2", "value1" }, { "elem1", "value2" } });
+        test(writer.getAll().size() == 3);
+        test(writer.getLast().getKey() == "elem1" && writer.getLast().getValue() == "value2");
+
+        writer.waitForNoReaders();
+    }
+    cout << "ok" << endl;
+
+    cout << "testing key handles... " << flush;
+    {
+        Topic<string, string> topic(node, "keyhandle");
+        auto writer = makeMultiKeyWriter(topic, { "elem1", "elem2" }, "", config);
+        writer.waitForReaders();
+
+        auto elem1 = writer.getKeyHandle("elem1");
+        test(elem1.getKey() == "elem1");
+        writer.add(elem1, "value1");
+        writer.update(elem1, "value2");
+        writer.remove(elem1);
+        test(writer.getLast().getKey() == "elem1" && writer.getLast().getEvent() == SampleEvent::Remove);
+
+        writer.waitForNoReaders();
+    }
+    cout << "ok" << endl;
+
+    cout << "testing coalesced updates... " << flush;
+    {
+        Topic<string, string> topic(node, "coalesce");
+        WriterConfig coalesceConfig;
+        coalesceConfig.flushSize = 3;
+        coalesceConfig.flushInterval = 60000;
+        auto writer = makeSingleKeyWriter(topic, "elem1", "", coalesceConfig);
+        writer.waitForReaders();
+
+        // The samples are sent once the flush size is reached.
+        writer.update("value1");
+        writer.update("value2");
+        writer.update("value3");
+
+        // The sample is sent on explicit flush.
+        writer.update("value4");
+        test(writer.getLast().getValue() == "value4");
+        writer.flush();
+
+        writer.waitForNoReaders();
+    }
+    cout << "ok" << endl;
+
+    cout << "testing delta updates... " << flush;
+    {
+        Topic<string, string> topic(node, "delta");
+        WriterConfig deltaConfig = config;
+        deltaConfig.deltaKeyFrameInterval = 3;
+        auto writer = makeSingleKeyWriter(topic, "elem1", "", deltaConfig);
+        writer.waitForReaders(2);
+
+        string value(256, 'a');
+        writer.add(value);
+        for(int i = 0; i < 5; ++i)
+        {
+            value[i * 50] = 'b';
+            writer.update(value);
+        }
+        writer.update("short");
+        writer.remove();
+
+        writer.waitForNoReaders();
+    }
+    cout << "ok" << endl;
+
+    cout << "testing compressed updates... " << flush;
+    {
+        Topic<string, string> topic(node, "compression");
+        WriterConfig compressionConfig = config;
+        compressionConfig.compression = Compression::Zlib;
+        compressionConfig.compressionThreshold = 0;
+        auto writer = makeSingleKeyWriter(topic, "elem1", "", compressionConfig);
+        writer.waitForReaders();
+
+        string value;
+        for(int i = 0; i < 100; ++i)
+        {
+            value += "value" + to_string(i % 10);
+        }
+        writer.add(value);
+        writer.update("short");
+        writer.update(value + value);
+        writer.remove();
+
+        writer.waitForNoReaders();
+    }
+    cout << "ok" << endl;
+
+    cout << "testing flow control... " << flush;
+    {
+        Topic<string, string> topic(node, "flowcontrol");
+        WriterConfig flowControlConfig = config;
+        flowControlConfig.highWaterMark = 1;
+        flowControlConfig.overflowPolicy = OverflowPolicy::Block;
+        auto writer = makeSingleKeyWriter(topic, "elem1", "", flowControlConfig);
+        writer.onOverflow([](string, bool) {});
+        writer.waitForReaders();
+
+        writer.add("value0");
+        for(int i = 1; i < 20; ++i)
+        {
+            writer.update("value" + to_string(i));
+        }
+        writer.remove();
+
+        writer.waitForNoReaders();
+    }
+    cout << "ok" << endl;
+
+    cout << "testing conflation... " << flush;
+    {
+        Topic<string, string> topic(node, "conflation");
+        topic.setUpdater<string>("concat", [](string& value, string update) { value += update; });
+        WriterConfig conflationConfig = config;
+        conflationConfig.overflowPolicy = OverflowPolicy::Conflate;
+        auto writer = makeMultiKeyWriter(topic, { "elem1", "elem2" }, "", conflationConfig);
+        writer.waitForReaders();
+
+        auto concat = writer.partialUpdate<string>("concat");
+        for(int i = 0; i < 50; ++i)
+        {
+            for(const auto& key : { "elem1", "elem2" })
+            {
+                writer.update(key, "value" + to_string(i));
+                concat(key, "x");
+            }
+        }
+        writer.remove("elem1");
+        writer.remove("elem2");
+
+        writer.waitForNoReaders();
+    }
+    cout << "ok" << endl;
+
+    cout << "testing sample rate limiting... " << flush;
+    {
+        Topic<string, string> topic(node, "ratelimit");
+        auto writer = makeSingleKeyWriter(topic, "elem1", "", config);
+        writer.waitForReaders();
+
+        writer.add("value0");
+        for(int i = 1; i < 100; ++i)
+        {
+            writer.update("value" + to_string(i));
+        }
+
+        writer.waitForNoReaders();
+    }
+    cout << "ok" << endl;
+
+    cout << "testing lazy decoding... " << flush;
+    {
+        Topic<string, string> topic(node, "lazydecode");
+        topic.setUpdater<string>("concat", [](string& value, string update) { value += update; });
+        auto writer = makeSingleKeyWriter(topic, "elem1", "", config);
+        writer.waitForReaders();
+
+        auto concat = writer.partialUpdate<string>("concat");
+        writer.add("value");
+        for(int i = 0; i < 50; ++i)
+        {
+            concat(to_string(i % 10));
+        }
+        writer.update("value");
+        writer.remove();
+
+        writer.waitForNoReaders();
+    }
+    cout << "ok" << endl;
+
+    cout << "testing sample batches... " << flush;
+    {
+        Topic<string, string> topic(node, "samplebatch");
+        auto writer = makeSingleKeyWriter(topic, "elem1", "", config);
+        writer.waitForReaders();
+        writer.add("value0");
+        for(int i = 1; i < 100; ++i)
+        {
+            writer.update("value" + to_string(i));
+        }
+        writer.waitForNoReaders();
+    }
+    cout << "ok" << endl;
+
+    cout << "testing unread samples draining... " << flush;
+    {
+        Topic<string, string> topic(node, "drain");
+        auto writer = makeSingleKeyWriter(topic, "elem1", "", config);
+        writer.waitForReaders(3);
+        writer.add("value0");
+        for(int i = 1; i < 10; ++i)
+        {
+            writer.update("value" + to_string(i));
+        }
+        writer.waitForNoReaders();
+    }
+    cout << "ok" << endl;
+
+    cout << "testing last value cache... " << flush;
+    {
+        Topic<string, string> topic(node, "lastvalue");
+        vector<string> keys = { "elem0", "elem1", "elem2", "elem3" };
+        auto writer = makeMultiKeyWriter(topic, keys, "", config);
+        writer.waitForReaders();
+        for(const auto& key : keys)
+        {
+            writer.add(key, "value0");
+            for(int i = 1; i < 4; ++i)
+            {
+                writer.update(key, "value" + to_string(i));
+            }
+        }
+        writer.remove("elem3");
+        writer.waitForNoReaders();
+    }
+    cout << "ok" << endl;
+
+    cout << "testing concurrent updates... " << flush;
+    {
+        Topic<string, string> topic(node, "concurrent");
+        vector<SingleKeyWriter<string, string>> writers;
+        for(int i = 0; i < 4; ++i)
+        {
+            writers.push_back(makeSingleKeyWriter(topic, "elem" + to_string(i), "", config));
+        }
+        for(auto& writer : writers)
+        {
+            writer.waitForReaders();
+        }
+
+        vector<thread> threads;
+        for(auto& writer : writers)
+        {
+            threads.emplace_back([&writer]
+            {
+                for(int i = 0; i < 100; ++i)
+                {
+                    writer.update("value" + to_string(i));
+                }
+            });
+        }
+        for(auto& t : threads)
+        {
+            t.join();
+        }
+
+        for(auto& writer : writers)
+        {
+            test(writer.getAll().size() == 100);
+            writer.waitForNoReaders();
+        }
+    }
+    cout << "ok" << endl;
+
     cout << "testing topic collocated key reader and writer... " << flush;
     {
         Topic<string, string> topic(node, "collocated");